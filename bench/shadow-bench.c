@@ -0,0 +1,393 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2015 Olivier Fourdan
+
+        xfwm4-shadow-bench checks the fixed point gaussian sums used for the
+        compositor shadows against the double precision 2D kernel they
+        replaced, for every supported radius, then times both of them
+        building the shadow of windows of common sizes.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gaussian.h"
+
+/* Largest shadow radius checked, the compositor uses SHADOW_RADIUS */
+#define SHADOW_MAX_RADIUS       32
+/* Number of opacity steps of the presummed shadow tables */
+#define SHADOW_OPACITY_STEPS    25
+
+typedef struct _reference_conv reference_conv;
+struct _reference_conv
+{
+    gint size;
+    gdouble *data;
+};
+
+typedef guchar (*ShadowSum) (gpointer map, gdouble opacity,
+                             gint x, gint y, gint width, gint height);
+
+static gint opt_radius = 12;
+static gint opt_iterations = 20;
+
+static GOptionEntry option_entries[] =
+{
+    { "radius", 'r', 0, G_OPTION_ARG_INT, &opt_radius, "Shadow radius to benchmark", "N" },
+    { "iterations", 'i', 0, G_OPTION_ARG_INT, &opt_iterations, "Number of shadows built per window size", "N" },
+    { NULL }
+};
+
+static const struct
+{
+    gint width;
+    gint height;
+} window_sizes[] = {
+    { 640, 480 },
+    { 1920, 1080 },
+    { 3840, 2160 }
+};
+
+/* The 2D double precision kernel of xfwm4 before the fixed point sums */
+static gdouble
+reference_gaussian (gdouble r, gdouble x, gdouble y)
+{
+    return ((1 / (sqrt (2 * G_PI * r))) *
+            exp ((- (x * x + y * y)) / (2 * r * r)));
+}
+
+static reference_conv *
+reference_map_new (gdouble r)
+{
+    reference_conv *c;
+    gint size, center;
+    gint x, y;
+    gdouble t, g;
+
+    size = ((gint) ceil ((r * 3)) + 1) & ~1;
+    center = size / 2;
+    c = g_malloc (sizeof (reference_conv) + size * size * sizeof (gdouble));
+    c->size = size;
+    c->data = (gdouble *) (c + 1);
+    t = 0.0;
+
+    for (y = 0; y < size; y++)
+    {
+        for (x = 0; x < size; x++)
+        {
+            g = reference_gaussian (r, (gdouble) (x - center), (gdouble) (y - center));
+            t += g;
+            c->data[y * size + x] = g;
+        }
+    }
+
+    for (y = 0; y < size; y++)
+    {
+        for (x = 0; x < size; x++)
+        {
+            c->data[y * size + x] /= t;
+        }
+    }
+
+    return c;
+}
+
+static guchar
+reference_sum (gpointer data, gdouble opacity, gint x, gint y, gint width, gint height)
+{
+    reference_conv *map;
+    gint fx, fy;
+    gdouble *g_data, *g_line;
+    gdouble v;
+    gint fx_start, fx_end;
+    gint fy_start, fy_end;
+    gint g_size, center;
+
+    map = (reference_conv *) data;
+    g_size = map->size;
+    center = g_size / 2;
+    fx_start = center - x;
+    if (fx_start < 0)
+    {
+        fx_start = 0;
+    }
+    fx_end = width + center - x;
+    if (fx_end > g_size)
+    {
+        fx_end = g_size;
+    }
+    fy_start = center - y;
+    if (fy_start < 0)
+    {
+        fy_start = 0;
+    }
+    fy_end = height + center - y;
+    if (fy_end > g_size)
+    {
+        fy_end = g_size;
+    }
+
+    v = 0.0;
+    g_line = map->data + fy_start * g_size + fx_start;
+    for (fy = fy_start; fy < fy_end; fy++)
+    {
+        g_data = g_line;
+        g_line += g_size;
+        for (fx = fx_start; fx < fx_end; fx++)
+        {
+            v += *g_data++;
+        }
+    }
+    if (v > 1)
+    {
+        v = 1;
+    }
+
+    return ((guchar) (v * opacity * 255.0));
+}
+
+static guchar
+fixed_sum (gpointer data, gdouble opacity, gint x, gint y, gint width, gint height)
+{
+    return gaussianSum ((gaussian_conv *) data, opacity, x, y, width, height);
+}
+
+/*
+ * Compares both sums over the positions where they vary: along the edges
+ * of a window the size of the presummed tables, and of a narrower one so
+ * that both sides of the kernel are clipped at once.
+ */
+static gint
+check_radius (gint r)
+{
+    gaussian_conv *map;
+    reference_conv *reference;
+    gint size, step, errors;
+    gint i, x, y, k;
+    gint width, height;
+    gdouble opacity;
+    gint a, b;
+
+    map = gaussianMapNew (r);
+    reference = reference_map_new (r);
+    size = map->size;
+    step = MAX (size / 16, 1);
+    errors = 0;
+
+    for (i = 0; i < 2; i++)
+    {
+        width = (i == 0) ? size * 2 : MAX (size / 2, 1);
+        height = width;
+        for (y = -size; y <= height + size; y += step)
+        {
+            for (x = -size; x <= width + size; x += step)
+            {
+                for (k = 1; k <= SHADOW_OPACITY_STEPS; k++)
+                {
+                    opacity = (gdouble) k / SHADOW_OPACITY_STEPS;
+                    a = fixed_sum (map, opacity, x, y, width, height);
+                    b = reference_sum (reference, opacity, x, y, width, height);
+                    if (ABS (a - b) > 1)
+                    {
+                        if (errors == 0)
+                        {
+                            g_printerr ("radius %i: %i instead of %i at %i,%i in %ix%i, opacity %.2f\n",
+                                        r, a, b, x, y, width, height, opacity);
+                        }
+                        errors++;
+                    }
+                }
+            }
+        }
+    }
+
+    g_free (reference);
+    g_free (map);
+
+    return errors;
+}
+
+/* Fills the alpha of a shadow the way make_shadow() in compositor.c does */
+static void
+build_shadow (ShadowSum sum, gpointer map, gint size, guchar *data,
+              gdouble opacity, gint width, gint height)
+{
+    gint swidth, sheight;
+    gint center;
+    gint x, y;
+    guchar d;
+
+    swidth = width + size;
+    sheight = height + size;
+    center = size / 2;
+
+    d = sum (map, opacity, center, center, width, height);
+    memset (data, d, sheight * swidth);
+
+    for (y = 0; y < size; y++)
+    {
+        for (x = 0; x < size; x++)
+        {
+            d = sum (map, opacity, x - center, y - center, width, height);
+            data[y * swidth + x] = d;
+            data[(sheight - y - 1) * swidth + x] = d;
+            data[(sheight - y - 1) * swidth + (swidth - x - 1)] = d;
+            data[y * swidth + (swidth - x - 1)] = d;
+        }
+    }
+
+    for (y = 0; y < size; y++)
+    {
+        d = sum (map, opacity, center, y - center, width, height);
+        memset (&data[y * swidth + size], d, swidth - 2 * size);
+        memset (&data[(sheight - y - 1) * swidth + size], d, swidth - 2 * size);
+    }
+
+    for (x = 0; x < size; x++)
+    {
+        d = sum (map, opacity, x - center, center, width, height);
+        for (y = size; y < sheight - size; y++)
+        {
+            data[y * swidth + x] = d;
+            data[y * swidth + (swidth - x - 1)] = d;
+        }
+    }
+}
+
+static gint64
+time_shadow (ShadowSum sum, gpointer map, gint size, gint width, gint height)
+{
+    guchar *data;
+    gint64 start;
+    gint i;
+
+    data = g_malloc ((width + size) * (height + size));
+    start = g_get_monotonic_time ();
+    for (i = 0; i < opt_iterations; i++)
+    {
+        build_shadow (sum, map, size, data, 0.5, width, height);
+    }
+    start = g_get_monotonic_time () - start;
+    g_free (data);
+
+    return start / opt_iterations;
+}
+
+static gint64
+time_presum (ShadowSum sum, gpointer map, gint size)
+{
+    gint64 start;
+    gint i, x, y;
+    guchar d;
+
+    d = 0;
+    start = g_get_monotonic_time ();
+    for (i = 0; i < opt_iterations; i++)
+    {
+        for (y = 0; y <= size; y++)
+        {
+            for (x = 0; x <= size; x++)
+            {
+                d ^= sum (map, 1, x - size / 2, y - size / 2, size * 2, size * 2);
+            }
+        }
+    }
+    start = g_get_monotonic_time () - start;
+    /* Keep the sums from being optimized away */
+    if (d == 0x100)
+    {
+        g_print ("\n");
+    }
+
+    return start / opt_iterations;
+}
+
+int
+main (int argc, char **argv)
+{
+    GOptionContext *context;
+    GError *error;
+    gaussian_conv *map;
+    reference_conv *reference;
+    gint64 start, fixed_time, reference_time;
+    gint r, i, errors;
+
+    context = g_option_context_new ("- check and benchmark the xfwm4 shadow gaussian");
+    g_option_context_add_main_entries (context, option_entries, NULL);
+    error = NULL;
+    if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+        g_printerr ("%s\n", error->message);
+        g_error_free (error);
+        g_option_context_free (context);
+        return EXIT_FAILURE;
+    }
+    g_option_context_free (context);
+    opt_radius = CLAMP (opt_radius, 1, SHADOW_MAX_RADIUS);
+    opt_iterations = MAX (opt_iterations, 1);
+
+    errors = 0;
+    for (r = 1; r <= SHADOW_MAX_RADIUS; r++)
+    {
+        errors += check_radius (r);
+    }
+    if (errors > 0)
+    {
+        g_printerr ("xfwm4-shadow-bench: %i sums differ from the reference by more than 1\n", errors);
+        return EXIT_FAILURE;
+    }
+    g_print ("xfwm4-shadow-bench: radius 1 to %i within 1 of the reference\n", SHADOW_MAX_RADIUS);
+
+    start = g_get_monotonic_time ();
+    map = gaussianMapNew (opt_radius);
+    fixed_time = g_get_monotonic_time () - start;
+    start = g_get_monotonic_time ();
+    reference = reference_map_new (opt_radius);
+    reference_time = g_get_monotonic_time () - start;
+
+    g_print ("radius %i, %i iterations\n", opt_radius, opt_iterations);
+    g_print ("%-18s %14s %14s\n", "workload", "fixed (usec)", "double (usec)");
+    g_print ("%-18s %14" G_GINT64_FORMAT " %14" G_GINT64_FORMAT "\n", "map", fixed_time, reference_time);
+    g_print ("%-18s %14" G_GINT64_FORMAT " %14" G_GINT64_FORMAT "\n", "presum",
+             time_presum (fixed_sum, map, map->size),
+             time_presum (reference_sum, reference, reference->size));
+    for (i = 0; i < (gint) G_N_ELEMENTS (window_sizes); i++)
+    {
+        gchar *name;
+
+        name = g_strdup_printf ("shadow %ix%i", window_sizes[i].width, window_sizes[i].height);
+        g_print ("%-18s %14" G_GINT64_FORMAT " %14" G_GINT64_FORMAT "\n", name,
+                 time_shadow (fixed_sum, map, map->size,
+                              window_sizes[i].width, window_sizes[i].height),
+                 time_shadow (reference_sum, reference, reference->size,
+                              window_sizes[i].width, window_sizes[i].height));
+        g_free (name);
+    }
+
+    g_free (reference);
+    g_free (map);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,754 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2015 Olivier Fourdan
+
+        xfwm4-bench starts xfwm4 against a private Xvfb server and drives
+        scripted workloads, reporting the wall time and the CPU time of
+        both xfwm4 and the X server for each of them, along with the
+        number of synchronous property round trips xfwm4 issued.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <X11/X.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/Xatom.h>
+
+#include <glib.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifndef XFWM4_PATH
+#define XFWM4_PATH "xfwm4"
+#endif
+
+/* How long to wait for the server, the window manager or an event */
+#define BENCH_TIMEOUT           10000
+/* Let the compositor catch up before reading the CPU time */
+#define BENCH_SETTLE_TIME       50000
+
+enum
+{
+    NET_ACTIVE_WINDOW = 0,
+    NET_CURRENT_DESKTOP,
+    NET_FRAME_EXTENTS,
+    NET_NUMBER_OF_DESKTOPS,
+    NET_REQUEST_FRAME_EXTENTS,
+    NET_SUPPORTING_WM_CHECK,
+    NET_WM_DESKTOP,
+    NET_WM_NAME,
+    UTF8_STRING,
+    ATOM_COUNT
+};
+
+static const char *atom_names[ATOM_COUNT] = {
+    "_NET_ACTIVE_WINDOW",
+    "_NET_CURRENT_DESKTOP",
+    "_NET_FRAME_EXTENTS",
+    "_NET_NUMBER_OF_DESKTOPS",
+    "_NET_REQUEST_FRAME_EXTENTS",
+    "_NET_SUPPORTING_WM_CHECK",
+    "_NET_WM_DESKTOP",
+    "_NET_WM_NAME",
+    "UTF8_STRING"
+};
+
+typedef struct _Bench Bench;
+struct _Bench
+{
+    Display *dpy;
+    Window root;
+    Atom atoms[ATOM_COUNT];
+    GC gc;
+
+    GPid xvfb_pid;
+    GPid xfwm4_pid;
+    gchar *property_stats_file;
+
+    /* Managed window kept around for the barrier, see bench_barrier () */
+    Window sentinel;
+    Window *windows;
+    gint n_windows;
+    gint iterations;
+    gint workspaces;
+};
+
+typedef struct _BenchSample BenchSample;
+struct _BenchSample
+{
+    gint64 wall;
+    gint64 xfwm4_cpu;
+    gint64 xvfb_cpu;
+    gint64 round_trips;
+};
+
+typedef gint (*BenchWorkload) (Bench *bench);
+
+static gchar *opt_xfwm4 = NULL;
+static gchar *opt_xvfb = NULL;
+static gint opt_windows = 100;
+static gint opt_iterations = 500;
+static gboolean opt_no_compositor = FALSE;
+
+static GOptionEntry option_entries[] =
+{
+    { "xfwm4", '\0', 0, G_OPTION_ARG_FILENAME, &opt_xfwm4, "Path of the xfwm4 binary to benchmark", "PATH" },
+    { "xvfb", '\0', 0, G_OPTION_ARG_FILENAME, &opt_xvfb, "Path of the Xvfb binary", "PATH" },
+    { "windows", 'n', 0, G_OPTION_ARG_INT, &opt_windows, "Number of windows to map", "N" },
+    { "iterations", 'i', 0, G_OPTION_ARG_INT, &opt_iterations, "Number of operations per workload", "N" },
+    { "no-compositor", '\0', 0, G_OPTION_ARG_NONE, &opt_no_compositor, "Run xfwm4 with the compositor disabled", NULL },
+    { NULL }
+};
+
+/* CPU time (user + system) consumed so far by a process, in usec */
+static gint64
+get_process_cpu_time (GPid pid)
+{
+    gchar *path, *contents, *ptr;
+    unsigned long utime, stime;
+    gint64 result;
+
+    result = 0;
+    path = g_strdup_printf ("/proc/%i/stat", (int) pid);
+    if (g_file_get_contents (path, &contents, NULL, NULL))
+    {
+        /* Skip the command name, it may contain spaces */
+        ptr = strrchr (contents, ')');
+        if ((ptr) && (sscanf (ptr + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+                              &utime, &stime) == 2))
+        {
+            result = (gint64) (utime + stime) * G_USEC_PER_SEC / sysconf (_SC_CLK_TCK);
+        }
+        g_free (contents);
+    }
+    g_free (path);
+
+    return result;
+}
+
+static gboolean
+wait_for_event (Bench *bench, XEvent *ev, gboolean (*match) (Bench *, XEvent *, gpointer), gpointer data)
+{
+    struct pollfd pfd;
+    gint64 deadline;
+    int timeout;
+
+    deadline = g_get_monotonic_time () + BENCH_TIMEOUT * 1000;
+    pfd.fd = ConnectionNumber (bench->dpy);
+    pfd.events = POLLIN;
+
+    for (;;)
+    {
+        while (XPending (bench->dpy))
+        {
+            XNextEvent (bench->dpy, ev);
+            if ((*match) (bench, ev, data))
+            {
+                return TRUE;
+            }
+        }
+        timeout = (int) ((deadline - g_get_monotonic_time ()) / 1000);
+        if ((timeout <= 0) || (poll (&pfd, 1, timeout) <= 0))
+        {
+            return FALSE;
+        }
+    }
+}
+
+static gboolean
+match_frame_extents (Bench *bench, XEvent *ev, gpointer data)
+{
+    return ((ev->type == PropertyNotify) &&
+            (ev->xproperty.window == *((Window *) data)) &&
+            (ev->xproperty.atom == bench->atoms[NET_FRAME_EXTENTS]) &&
+            (ev->xproperty.state == PropertyNewValue));
+}
+
+static void
+send_client_message (Bench *bench, Window w, int atom_id, long l0, long l1, long l2)
+{
+    XEvent ev;
+
+    memset (&ev, 0, sizeof (ev));
+    ev.xclient.type = ClientMessage;
+    ev.xclient.window = w;
+    ev.xclient.message_type = bench->atoms[atom_id];
+    ev.xclient.format = 32;
+    ev.xclient.data.l[0] = l0;
+    ev.xclient.data.l[1] = l1;
+    ev.xclient.data.l[2] = l2;
+    XSendEvent (bench->dpy, bench->root, False,
+                SubstructureRedirectMask | SubstructureNotifyMask, &ev);
+}
+
+/*
+ * Wait until xfwm4 has processed everything sent so far: the window
+ * manager handles its events in order, so once it has answered a
+ * _NET_REQUEST_FRAME_EXTENTS, it is done with all previous requests.
+ * The request is sent for the sentinel, which exists before any
+ * workload runs, so every workload can be measured.
+ */
+static gboolean
+bench_barrier (Bench *bench)
+{
+    XEvent ev;
+    Window w;
+
+    w = bench->sentinel;
+    XDeleteProperty (bench->dpy, w, bench->atoms[NET_FRAME_EXTENTS]);
+    send_client_message (bench, w, NET_REQUEST_FRAME_EXTENTS, 0, 0, 0);
+    XFlush (bench->dpy);
+
+    return wait_for_event (bench, &ev, match_frame_extents, &w);
+}
+
+static gboolean
+match_map_notify (Bench *bench, XEvent *ev, gpointer data)
+{
+    gint *remaining = (gint *) data;
+
+    if (ev->type == MapNotify)
+    {
+        (*remaining)--;
+    }
+    return (*remaining == 0);
+}
+
+static gboolean
+match_window_map_notify (Bench *bench, XEvent *ev, gpointer data)
+{
+    return ((ev->type == MapNotify) && (ev->xmap.window == *((Window *) data)));
+}
+
+static void
+set_window_title (Bench *bench, Window w, const gchar *title)
+{
+    XChangeProperty (bench->dpy, w, bench->atoms[NET_WM_NAME], bench->atoms[UTF8_STRING], 8,
+                     PropModeReplace, (unsigned char *) title, strlen (title));
+}
+
+/* Map the sentinel and wait until xfwm4 has framed it */
+static gboolean
+create_sentinel (Bench *bench)
+{
+    XSetWindowAttributes attr;
+    XEvent ev;
+
+    attr.background_pixel = BlackPixel (bench->dpy, DefaultScreen (bench->dpy));
+    attr.event_mask = StructureNotifyMask | PropertyChangeMask;
+    bench->sentinel = XCreateWindow (bench->dpy, bench->root, 0, 0, 16, 16, 0,
+                                     CopyFromParent, InputOutput, CopyFromParent,
+                                     CWBackPixel | CWEventMask, &attr);
+    XStoreName (bench->dpy, bench->sentinel, "xfwm4-bench sentinel");
+    set_window_title (bench, bench->sentinel, "xfwm4-bench sentinel");
+    XMapWindow (bench->dpy, bench->sentinel);
+    XFlush (bench->dpy);
+
+    return wait_for_event (bench, &ev, match_window_map_notify, &bench->sentinel);
+}
+
+static gint
+workload_map (Bench *bench)
+{
+    XSetWindowAttributes attr;
+    XEvent ev;
+    gchar *title;
+    gint i, remaining;
+
+    bench->windows = g_new0 (Window, bench->n_windows);
+    attr.background_pixel = WhitePixel (bench->dpy, DefaultScreen (bench->dpy));
+    attr.event_mask = StructureNotifyMask | PropertyChangeMask;
+    for (i = 0; i < bench->n_windows; i++)
+    {
+        bench->windows[i] = XCreateWindow (bench->dpy, bench->root,
+                                           (i * 37) % 1500, (i * 23) % 800, 320, 240, 0,
+                                           CopyFromParent, InputOutput, CopyFromParent,
+                                           CWBackPixel | CWEventMask, &attr);
+        title = g_strdup_printf ("xfwm4-bench %i", i);
+        XStoreName (bench->dpy, bench->windows[i], title);
+        set_window_title (bench, bench->windows[i], title);
+        g_free (title);
+        XMapWindow (bench->dpy, bench->windows[i]);
+    }
+    XFlush (bench->dpy);
+
+    /* The window manager maps the windows once they are framed */
+    remaining = bench->n_windows;
+    if (!wait_for_event (bench, &ev, match_map_notify, &remaining))
+    {
+        return -1;
+    }
+
+    return bench->n_windows;
+}
+
+static gint
+workload_move_resize (Bench *bench)
+{
+    gint i;
+
+    for (i = 0; i < bench->iterations; i++)
+    {
+        XMoveResizeWindow (bench->dpy, bench->windows[i % bench->n_windows],
+                           (i * 13) % 1500, (i * 7) % 800,
+                           200 + (i % 200), 150 + (i % 150));
+    }
+    return bench->iterations;
+}
+
+static gint
+workload_focus_cycle (Bench *bench)
+{
+    gint i;
+
+    for (i = 0; i < bench->iterations; i++)
+    {
+        /* Source indication 2, act as a pager so focus stealing prevention does not interfere */
+        send_client_message (bench, bench->windows[i % bench->n_windows],
+                             NET_ACTIVE_WINDOW, 2, CurrentTime, None);
+    }
+    return bench->iterations;
+}
+
+static gint
+workload_workspace_switch (Bench *bench)
+{
+    gint i;
+
+    if (bench->workspaces < 2)
+    {
+        return 0;
+    }
+
+    /* Spread the windows over the workspaces first */
+    for (i = 0; i < bench->n_windows; i++)
+    {
+        send_client_message (bench, bench->windows[i], NET_WM_DESKTOP,
+                             i % bench->workspaces, 2, 0);
+    }
+    if (!bench_barrier (bench))
+    {
+        return -1;
+    }
+
+    for (i = 0; i < bench->iterations; i++)
+    {
+        send_client_message (bench, bench->root, NET_CURRENT_DESKTOP,
+                             (i + 1) % bench->workspaces, CurrentTime, 0);
+    }
+    return bench->iterations;
+}
+
+static gint
+workload_retitle (Bench *bench)
+{
+    gchar *title;
+    gint i;
+
+    /* A few windows updating their title at a high rate, like busy terminals */
+    for (i = 0; i < bench->iterations; i++)
+    {
+        title = g_strdup_printf ("xfwm4-bench title update %i", i);
+        set_window_title (bench, bench->windows[i % MIN (8, bench->n_windows)], title);
+        g_free (title);
+    }
+    return bench->iterations;
+}
+
+static gint
+workload_damage (Bench *bench)
+{
+    gint i;
+
+    for (i = 0; i < bench->iterations; i++)
+    {
+        XSetForeground (bench->dpy, bench->gc, (unsigned long) (i * 0x10101) & 0xffffff);
+        XFillRectangle (bench->dpy, bench->windows[i % bench->n_windows], bench->gc,
+                        (i * 11) % 300, (i * 5) % 220, 20, 20);
+    }
+    return bench->iterations;
+}
+
+static gint
+workload_unmap (Bench *bench)
+{
+    gint i;
+
+    for (i = 0; i < bench->n_windows; i++)
+    {
+        XDestroyWindow (bench->dpy, bench->windows[i]);
+    }
+    return bench->n_windows;
+}
+
+/* Have xfwm4 dump its property statistics and return the round trip total */
+static gint64
+get_round_trips (Bench *bench)
+{
+    gchar *contents, *ptr;
+    gint64 deadline;
+    gint64 result;
+
+    if (bench->property_stats_file == NULL)
+    {
+        return -1;
+    }
+
+    /* The statistics are written atomically once xfwm4 goes idle */
+    unlink (bench->property_stats_file);
+    kill (bench->xfwm4_pid, SIGUSR1);
+
+    result = -1;
+    deadline = g_get_monotonic_time () + BENCH_TIMEOUT * 1000;
+    while ((result < 0) && (g_get_monotonic_time () < deadline))
+    {
+        /* Wake xfwm4 up so it notices the signal once its queue drains */
+        if (!bench_barrier (bench))
+        {
+            break;
+        }
+        if (g_file_get_contents (bench->property_stats_file, &contents, NULL, NULL))
+        {
+            ptr = strstr (contents, "\"total_round_trips\":");
+            if (ptr)
+            {
+                result = g_ascii_strtoll (ptr + strlen ("\"total_round_trips\":"), NULL, 10);
+            }
+            g_free (contents);
+        }
+        else
+        {
+            g_usleep (10000);
+        }
+    }
+
+    return result;
+}
+
+static gboolean
+run_workload (Bench *bench, const gchar *name, BenchWorkload workload)
+{
+    BenchSample start, end;
+    gint ops;
+
+    XSync (bench->dpy, False);
+
+    start.round_trips = get_round_trips (bench);
+    start.xfwm4_cpu = get_process_cpu_time (bench->xfwm4_pid);
+    start.xvfb_cpu = get_process_cpu_time (bench->xvfb_pid);
+    start.wall = g_get_monotonic_time ();
+
+    ops = (*workload) (bench);
+    if ((ops < 0) || !bench_barrier (bench))
+    {
+        g_printerr ("Workload \"%s\" timed out\n", name);
+        return FALSE;
+    }
+
+    end.wall = g_get_monotonic_time ();
+    g_usleep (BENCH_SETTLE_TIME);
+    end.xfwm4_cpu = get_process_cpu_time (bench->xfwm4_pid);
+    end.xvfb_cpu = get_process_cpu_time (bench->xvfb_pid);
+    end.round_trips = get_round_trips (bench);
+
+    if (ops == 0)
+    {
+        g_print ("%-18s %8s\n", name, "skipped");
+        return TRUE;
+    }
+    g_print ("%-18s %8i %12.2f %12.1f %14.1f %14.1f", name, ops,
+             (end.wall - start.wall) / 1000.0,
+             (gdouble) (end.wall - start.wall) / ops,
+             (gdouble) (end.xfwm4_cpu - start.xfwm4_cpu) / ops,
+             (gdouble) (end.xvfb_cpu - start.xvfb_cpu) / ops);
+    if ((start.round_trips >= 0) && (end.round_trips >= 0))
+    {
+        g_print (" %14.2f\n", (gdouble) (end.round_trips - start.round_trips) / ops);
+    }
+    else
+    {
+        g_print (" %14s\n", "n/a");
+    }
+
+    return TRUE;
+}
+
+static gchar *
+start_xvfb (Bench *bench)
+{
+    gchar *argv[10];
+    gchar *displayfd;
+    gchar buffer[32];
+    int fds[2];
+    ssize_t len;
+    GError *error;
+
+    if (pipe (fds) < 0)
+    {
+        g_printerr ("Cannot create pipe: %s\n", g_strerror (errno));
+        return NULL;
+    }
+
+    /* Let Xvfb pick a free display and write its number to the pipe */
+    displayfd = g_strdup_printf ("%i", fds[1]);
+    argv[0] = opt_xvfb ? opt_xvfb : "Xvfb";
+    argv[1] = "-displayfd";
+    argv[2] = displayfd;
+    argv[3] = "-screen";
+    argv[4] = "0";
+    argv[5] = "1920x1080x24";
+    argv[6] = "-nolisten";
+    argv[7] = "tcp";
+    argv[8] = NULL;
+
+    error = NULL;
+    if (!g_spawn_async (NULL, argv, NULL,
+                        G_SPAWN_SEARCH_PATH | G_SPAWN_LEAVE_DESCRIPTORS_OPEN | G_SPAWN_DO_NOT_REAP_CHILD,
+                        NULL, NULL, &bench->xvfb_pid, &error))
+    {
+        g_printerr ("Cannot start Xvfb: %s\n", error->message);
+        g_error_free (error);
+        g_free (displayfd);
+        close (fds[0]);
+        close (fds[1]);
+        return NULL;
+    }
+    g_free (displayfd);
+    close (fds[1]);
+
+    len = read (fds[0], buffer, sizeof (buffer) - 1);
+    close (fds[0]);
+    if (len <= 0)
+    {
+        g_printerr ("Xvfb did not report its display\n");
+        return NULL;
+    }
+    buffer[len] = '\0';
+
+    return g_strdup_printf (":%i", atoi (buffer));
+}
+
+static gboolean
+start_xfwm4 (Bench *bench, const gchar *display_name)
+{
+    gchar *argv[6];
+    gchar *property_stats;
+    gchar **envp;
+    GError *error;
+    Window check;
+    Atom type;
+    int format;
+    unsigned long nitems, bytes_after;
+    unsigned char *data;
+    gint64 deadline;
+
+    argv[0] = opt_xfwm4 ? opt_xfwm4 : XFWM4_PATH;
+    argv[1] = opt_no_compositor ? "--compositor=off" : "--compositor=on";
+    argv[2] = "--sm-client-disable";
+    argv[3] = NULL;
+    property_stats = NULL;
+    if (bench->property_stats_file)
+    {
+        property_stats = g_strdup_printf ("--property-stats=%s", bench->property_stats_file);
+        argv[3] = property_stats;
+        argv[4] = NULL;
+    }
+
+    envp = g_environ_setenv (g_get_environ (), "DISPLAY", display_name, TRUE);
+    error = NULL;
+    if (!g_spawn_async (NULL, argv, envp, G_SPAWN_DO_NOT_REAP_CHILD,
+                        NULL, NULL, &bench->xfwm4_pid, &error))
+    {
+        g_printerr ("Cannot start xfwm4: %s\n", error->message);
+        g_error_free (error);
+        g_strfreev (envp);
+        g_free (property_stats);
+        return FALSE;
+    }
+    g_strfreev (envp);
+    g_free (property_stats);
+
+    /* The window manager is ready once it advertises itself on the root window */
+    deadline = g_get_monotonic_time () + BENCH_TIMEOUT * 1000;
+    while (g_get_monotonic_time () < deadline)
+    {
+        check = None;
+        data = NULL;
+        if ((XGetWindowProperty (bench->dpy, bench->root, bench->atoms[NET_SUPPORTING_WM_CHECK],
+                                 0L, 1L, False, XA_WINDOW, &type, &format, &nitems,
+                                 &bytes_after, &data) == Success) && (data))
+        {
+            if (nitems == 1)
+            {
+                check = *((Window *) data);
+            }
+            XFree (data);
+        }
+        if (check != None)
+        {
+            return TRUE;
+        }
+        g_usleep (50000);
+    }
+
+    g_printerr ("xfwm4 did not start\n");
+    return FALSE;
+}
+
+static gint
+get_workspace_count (Bench *bench)
+{
+    Atom type;
+    int format;
+    unsigned long nitems, bytes_after;
+    unsigned char *data;
+    gint count;
+
+    count = 0;
+    data = NULL;
+    if ((XGetWindowProperty (bench->dpy, bench->root, bench->atoms[NET_NUMBER_OF_DESKTOPS],
+                             0L, 1L, False, XA_CARDINAL, &type, &format, &nitems,
+                             &bytes_after, &data) == Success) && (data))
+    {
+        if (nitems == 1)
+        {
+            count = (gint) *((long *) data);
+        }
+        XFree (data);
+    }
+
+    return count;
+}
+
+static void
+stop_process (GPid pid)
+{
+    if (pid > 0)
+    {
+        kill (pid, SIGTERM);
+        waitpid (pid, NULL, 0);
+        g_spawn_close_pid (pid);
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+    GOptionContext *context;
+    GError *error;
+    Bench bench;
+    gchar *display_name;
+    gboolean success;
+    int fd;
+
+    context = g_option_context_new ("- benchmark xfwm4 on a headless X server");
+    g_option_context_add_main_entries (context, option_entries, NULL);
+    error = NULL;
+    if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+        g_printerr ("%s\n", error->message);
+        g_error_free (error);
+        g_option_context_free (context);
+        return EXIT_FAILURE;
+    }
+    g_option_context_free (context);
+
+    memset (&bench, 0, sizeof (bench));
+    bench.n_windows = MAX (opt_windows, 1);
+    bench.iterations = MAX (opt_iterations, 1);
+    bench.property_stats_file = g_build_filename (g_get_tmp_dir (), "xfwm4-bench-XXXXXX", NULL);
+    fd = g_mkstemp (bench.property_stats_file);
+    if (fd < 0)
+    {
+        g_free (bench.property_stats_file);
+        bench.property_stats_file = NULL;
+    }
+    else
+    {
+        close (fd);
+    }
+
+    display_name = start_xvfb (&bench);
+    if (display_name == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+
+    success = FALSE;
+    bench.dpy = XOpenDisplay (display_name);
+    if (bench.dpy == NULL)
+    {
+        g_printerr ("Cannot open display %s\n", display_name);
+        goto out;
+    }
+    bench.root = DefaultRootWindow (bench.dpy);
+    XInternAtoms (bench.dpy, (char **) atom_names, ATOM_COUNT, False, bench.atoms);
+    bench.gc = XCreateGC (bench.dpy, bench.root, 0, NULL);
+
+    if (!start_xfwm4 (&bench, display_name))
+    {
+        goto out;
+    }
+    bench.workspaces = get_workspace_count (&bench);
+    if (!create_sentinel (&bench))
+    {
+        g_printerr ("xfwm4 did not map the sentinel window\n");
+        goto out;
+    }
+
+    g_print ("xfwm4-bench: %i windows, %i operations per workload, compositor %s\n",
+             bench.n_windows, bench.iterations, opt_no_compositor ? "off" : "on");
+    g_print ("%-18s %8s %12s %12s %14s %14s %14s\n", "workload", "ops", "wall (ms)",
+             "usec/op", "xfwm4 usec/op", "Xvfb usec/op", "round trips/op");
+
+    success = run_workload (&bench, "map", workload_map) &&
+              run_workload (&bench, "move-resize", workload_move_resize) &&
+              run_workload (&bench, "focus-cycle", workload_focus_cycle) &&
+              run_workload (&bench, "workspace-switch", workload_workspace_switch) &&
+              run_workload (&bench, "retitle", workload_retitle) &&
+              run_workload (&bench, "damage", workload_damage) &&
+              run_workload (&bench, "unmap", workload_unmap);
+
+out:
+    stop_process (bench.xfwm4_pid);
+    if (bench.dpy)
+    {
+        XCloseDisplay (bench.dpy);
+    }
+    stop_process (bench.xvfb_pid);
+    g_free (bench.windows);
+    if (bench.property_stats_file)
+    {
+        unlink (bench.property_stats_file);
+        g_free (bench.property_stats_file);
+    }
+    g_free (display_name);
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
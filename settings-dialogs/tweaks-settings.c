@@ -205,6 +205,7 @@ wm_tweaks_dialog_configure_widgets (GtkBuilder *builder)
     GtkWidget *use_compositing_box = GTK_WIDGET (gtk_builder_get_object (builder, "use_compositing_box"));
 
     GtkWidget *unredirect_overlays_check = GTK_WIDGET (gtk_builder_get_object (builder, "unredirect_overlays_check"));
+    GtkWidget *unredirect_fullscreen_check = GTK_WIDGET (gtk_builder_get_object (builder, "unredirect_fullscreen_check"));
     GtkWidget *sync_to_vblank_check = GTK_WIDGET (gtk_builder_get_object (builder, "sync_to_vblank_check"));
     GtkWidget *cycle_preview_check = GTK_WIDGET (gtk_builder_get_object (builder, "cycle_preview_check"));
     GtkWidget *show_frame_shadow_check = GTK_WIDGET (gtk_builder_get_object (builder, "show_frame_shadow_check"));
@@ -399,6 +400,10 @@ wm_tweaks_dialog_configure_widgets (GtkBuilder *builder)
                             "/general/unredirect_overlays",
                             G_TYPE_BOOLEAN,
                             (GObject *)unredirect_overlays_check, "active");
+    xfconf_g_property_bind (xfwm4_channel,
+                            "/general/unredirect_fullscreen",
+                            G_TYPE_BOOLEAN,
+                            (GObject *)unredirect_fullscreen_check, "active");
 #ifdef HAVE_EPOXY
     xfconf_g_property_bind (xfwm4_channel,
                             "/general/sync_to_vblank",
@@ -42,6 +42,10 @@
 #include <gtk/gtk.h>
 #include <libxfce4util/libxfce4util.h>
 
+#ifdef HAVE_XCB
+#include <X11/Xlib-xcb.h>
+#endif
+
 #include "client.h"
 #include "compositor.h"
 #include "focus.h"
@@ -54,6 +58,7 @@
 #include "mywindow.h"
 #include "netwm.h"
 #include "placement.h"
+#include "sandbox.h"
 #include "screen.h"
 #include "session.h"
 #include "settings.h"
@@ -260,6 +265,64 @@ clientUpdateName (Client *c)
     }
 }
 
+void
+clientQueuePropUpdate (Client *c, unsigned long props)
+{
+    g_return_if_fail (c != NULL);
+    TRACE ("entering clientQueuePropUpdate");
+
+    FLAG_SET (c->pending_props, props);
+    c->screen_info->display_info->pending_props = TRUE;
+}
+
+void
+clientFlushPendingProps (DisplayInfo *display_info)
+{
+    GSList *list;
+    Client *c;
+    unsigned long props;
+
+    g_return_if_fail (display_info != NULL);
+
+    if (!display_info->pending_props)
+    {
+        return;
+    }
+    TRACE ("entering clientFlushPendingProps");
+
+    display_info->pending_props = FALSE;
+    for (list = display_info->clients; list; list = g_slist_next (list))
+    {
+        c = (Client *) list->data;
+        props = c->pending_props;
+        if (!props)
+        {
+            continue;
+        }
+        c->pending_props = 0L;
+
+        if (FLAG_TEST (props, PENDING_PROP_NAME))
+        {
+            clientUpdateName (c);
+        }
+        if (FLAG_TEST (props, PENDING_PROP_OPACITY))
+        {
+            if (!getOpacity (display_info, c->window, &c->opacity))
+            {
+                c->opacity = NET_WM_OPAQUE;
+            }
+            clientSetOpacity (c, c->opacity, 0, 0);
+        }
+        if (FLAG_TEST (props, PENDING_PROP_STRUTS))
+        {
+            if (clientGetNetStruts (c) && FLAG_TEST (c->xfwm_flags, XFWM_FLAG_VISIBLE))
+            {
+                workspaceUpdateArea (c->screen_info);
+            }
+        }
+    }
+}
+
 static void
 clientRecomputeMaximizeSize (Client *c)
 {
@@ -325,7 +388,8 @@ clientUpdateAllFrames (ScreenInfo *screen_info, int mask)
         }
         if (configure_flags != 0L)
         {
-            clientReconfigure (c, configure_flags);
+            /* Redraw all the frames in one batch, see frameQueueDraw() */
+            clientReconfigure (c, configure_flags | CFG_QUEUE_REDRAW);
         }
         if (mask & UPDATE_FRAME)
         {
@@ -652,7 +716,14 @@ clientConfigureWindows (Client *c, XWindowChanges * wc, unsigned long mask, unsi
 
     if ((WIN_RESIZED) || (flags & CFG_FORCE_REDRAW))
     {
-        frameDraw (c, (flags & CFG_FORCE_REDRAW));
+        if (flags & CFG_QUEUE_REDRAW)
+        {
+            frameQueueDraw (c, (flags & CFG_FORCE_REDRAW));
+        }
+        else
+        {
+            frameDraw (c, (flags & CFG_FORCE_REDRAW));
+        }
     }
 
     if (flags & CFG_FORCE_REDRAW)
@@ -1349,10 +1420,7 @@ clientFree (Client *c)
     {
         g_source_remove (c->icon_timeout_id);
     }
-    if (c->frame_timeout_id)
-    {
-        g_source_remove (c->frame_timeout_id);
-    }
+    frameClearQueueDraw (c);
     if (c->ping_timeout_id)
     {
         clientRemoveNetWMPing (c);
@@ -1377,6 +1445,10 @@ clientFree (Client *c)
     {
         g_free (c->name);
     }
+    if (c->title_layout)
+    {
+        g_object_unref (G_OBJECT (c->title_layout));
+    }
     if (c->sandbox_name)
     {
         g_free (c->sandbox_name);
@@ -1613,81 +1685,6 @@ clientRestoreSizePos (Client *c)
 
 
 
-static void clientLoadDomainEnv (Client *c, const pid_t domain_pid)
-{
-    char    *env_path;
-    FILE    *fp;
-    char    *buffer = NULL;
-    char    *value;
-    size_t   n = 0;
-    ssize_t  linelen = 0;
-
-    env_path = g_strdup_printf("%s/%d/%s", EXECHELP_RUN_DIR, domain_pid, DOMAIN_ENV_FILE);
-    if (!env_path)
-    {
-        g_warning ("Cannot allocate memory for client id %d's sandbox domain %d environment file: %s", c->pid, domain_pid, strerror (errno));
-        return;
-    }
-
-    fp = fopen(env_path, "rb");
-    free(env_path);
-
-    if (!fp)
-    {
-        g_warning ("Cannot client id %d's sandbox domain %d environment file: %s", c->pid, domain_pid, strerror (errno));
-        return;
-    }
-
-    buffer = NULL;
-    n = 0;
-    linelen = 0;
-    errno = 0;
-    while ((linelen = getline(&buffer, &n, fp)) != -1)
-    {
-        if (buffer[linelen-1] == '\n')
-            buffer[linelen-1] = '\0';
-
-        value = strchr(buffer, '=');
-        if (value)
-        {
-            *value = 0;
-            value += 1;
-
-            if (g_strcmp0 (buffer, "FIREJAIL_SANDBOX_TYPE") == 0)
-            {
-                if (g_strcmp0 (value, "untrusted") == 0)
-                    c->sandboxed = SANDBOXED_UNTRUSTED;
-                else if (g_strcmp0 (value, "protected") == 0)
-                    c->sandboxed = SANDBOXED_PROTECTED;
-            }
-            else if (g_strcmp0 (buffer, "FIREJAIL_SANDBOX_NAME") == 0)
-            {
-                c->sandbox_name = g_strdup (value);
-            }
-            else if (g_strcmp0 (buffer, "FIREJAIL_SANDBOX_WORKSPACE") == 0)
-            {
-                c->sandbox_workspace = g_strdup (value);
-            }
-            else if (g_strcmp0 (buffer, "container") == 0 || g_strcmp0 (buffer, "CONTAINER") == 0)
-            {
-                c->container_name = g_strdup (value);
-            }
-        }
-        else
-        {
-            g_warning ("Invalid line in client id %d's sandbox domain %d environment file: %s", c->pid, domain_pid, buffer);
-        }
-
-        free(buffer);
-        buffer = NULL;
-        n = 0;
-    }
-
-    fclose(fp);
-}
-
-
-
 static void
 clientReadSandboxParameters (DisplayInfo *display_info, Client *c)
 {
@@ -1702,6 +1699,7 @@ clientReadSandboxParameters (DisplayInfo *display_info, Client *c)
     c->sandboxed = UNSANDBOXED;
     c->sandbox_name = NULL;
     c->sandbox_workspace = NULL;
+    c->sandbox_ws_serial = 0;
     c->container_name = NULL;
 
     g_return_if_fail(c != NULL);
@@ -1804,17 +1802,11 @@ clientReadSandboxParameters (DisplayInfo *display_info, Client *c)
     if (c->sandboxed != UNSANDBOXED)
         return;
 
-    gchar *host_name = NULL;
-    if (!getWindowHostname(display_info, c->window, &host_name))
+    /* The host name was read when framing the client, domains are cached in sandbox.c */
+    if ((c->hostname == NULL) || (*c->hostname == '\0'))
         return;
 
-    pid_t pid;
-    if (name2pid(host_name, &pid) == 0)
-    {
-        clientLoadDomainEnv (c, pid);
-    }
-
-    g_free (host_name);
+    sandboxLoadDomain (c, c->hostname);
 }
 
 Client *
@@ -1825,6 +1817,7 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
     XSetWindowAttributes attributes;
     Client *c = NULL;
     gboolean shaped;
+    gboolean prefetched;
     unsigned long valuemask;
     long pid;
     int i;
@@ -1888,6 +1881,16 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
         return NULL;
     }
 
+    if ((recapture) && (attr.map_state != IsViewable))
+    {
+        /* Unmapped since clientFrameAll() listed it, the server is not grabbed in between */
+        TRACE ("Window 0x%lx is not viewable anymore", w);
+        compositorAddWindow (display_info, w, NULL);
+        myDisplayUngrabServer (display_info);
+        gdk_error_trap_pop ();
+        return NULL;
+    }
+
     c = g_new0 (Client, 1);
     if (!c)
     {
@@ -1905,6 +1908,12 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
     c->dialog_pid = 0;
     c->dialog_fd = -1;
 
+    /* Property changes are tracked while managed, so values can be kept meanwhile */
+    watchCachedHints (display_info, c->window);
+
+    /* Fetch the client properties in one go, the server is grabbed */
+    prefetched = prefetchClientHints (display_info, c->window);
+
     getWindowName (display_info, c->window, &c->name);
     getWindowHostname (display_info, c->window, &c->hostname);
     getTransientFor (display_info, screen_info->xroot, c->window, &c->transient_for);
@@ -1982,8 +1991,8 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
 
     /* Timout for asynchronous icon update */
     c->icon_timeout_id = 0;
-    /* Timout for asynchronous frame update */
-    c->frame_timeout_id = 0;
+    /* Asynchronous frame update */
+    c->frame_queued = FALSE;
     /* Timeout for blinking on urgency */
     c->blink_timeout_id = 0;
     /* Ping timeout  */
@@ -1993,7 +2002,7 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
 
     c->class.res_name = NULL;
     c->class.res_class = NULL;
-    XGetClassHint (display_info->dpy, w, &c->class);
+    getClassHint (display_info, w, &c->class);
     c->wmhints = XGetWMHints (display_info->dpy, c->window);
     c->group_leader = None;
     if (c->wmhints)
@@ -2081,6 +2090,9 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
     clientGetGtkFrameExtents(c);
     clientGetGtkHideTitlebar(c);
 
+    /* From now on, we may change the properties ourselves */
+    releasePrefetchedHints (display_info, prefetched ? None : c->window);
+
     /* Once we know the type of window, we can initialize window position */
     if (!FLAG_TEST (c->xfwm_flags, XFWM_FLAG_SESSION_MANAGED))
     {
@@ -2204,6 +2216,7 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
         xfwmWindowCreate (screen_info, c->visual, c->depth, c->frame,
             &c->buttons[i], BUTTON_EVENT_MASK, None);
     }
+    myDisplayAddClientFrameParts (display_info, c);
     clientUpdateIconPix (c);
 
     /* Put the window on top to avoid XShape, that speeds up hw accelerated
@@ -2306,6 +2319,8 @@ clientUnframe (Client *c, gboolean remap)
     XUnmapWindow (display_info->dpy, c->frame);
     clientCoordGravitate (c, c->gravity, REMOVE, &c->x, &c->y);
     XSelectInput (display_info->dpy, c->window, NoEventMask);
+    /* Property changes are not reported anymore */
+    forgetCachedHints (display_info, c->window);
     XChangeSaveSet(display_info->dpy, c->window, SetModeDelete);
 
     reparented = XCheckTypedWindowEvent (display_info->dpy, c->window, ReparentNotify, &ev);
@@ -2365,18 +2380,76 @@ clientUnframe (Client *c, gboolean remap)
     clientFree (c);
 }
 
+/*
+ * Tell which of the top-level windows are viewable and which are override
+ * redirect, querying them all at once
+ */
+static void
+client_query_viewable (DisplayInfo *display_info, const Window *wins, unsigned int count,
+                       gboolean *viewable, gboolean *override_redirect)
+{
+#ifdef HAVE_XCB
+    xcb_connection_t *conn;
+    xcb_get_window_attributes_cookie_t *cookies;
+    xcb_get_window_attributes_reply_t *reply;
+    xcb_generic_error_t *error;
+    unsigned int i;
+
+    conn = XGetXCBConnection (display_info->dpy);
+    cookies = g_new (xcb_get_window_attributes_cookie_t, count);
+    for (i = 0; i < count; i++)
+    {
+        cookies[i] = xcb_get_window_attributes (conn, wins[i]);
+    }
+    for (i = 0; i < count; i++)
+    {
+        error = NULL;
+        reply = xcb_get_window_attributes_reply (conn, cookies[i], &error);
+        viewable[i] = ((reply) && (reply->map_state == XCB_MAP_STATE_VIEWABLE));
+        override_redirect[i] = ((reply) && (reply->override_redirect));
+        free (reply);
+        free (error);
+    }
+    g_free (cookies);
+#else  /* HAVE_XCB */
+    XWindowAttributes attr;
+    unsigned int i;
+
+    gdk_error_trap_push ();
+    for (i = 0; i < count; i++)
+    {
+        if (XGetWindowAttributes (display_info->dpy, wins[i], &attr))
+        {
+            viewable[i] = (attr.map_state == IsViewable);
+            override_redirect[i] = attr.override_redirect;
+        }
+        else
+        {
+            viewable[i] = FALSE;
+            override_redirect[i] = FALSE;
+        }
+    }
+    gdk_error_trap_pop ();
+#endif /* HAVE_XCB */
+}
+
 void
 clientFrameAll (ScreenInfo *screen_info)
 {
     DisplayInfo *display_info;
-    XWindowAttributes attr;
     xfwmWindow shield;
-    Window w1, w2, *wins;
-    unsigned int count, i;
+    Window w1, w2, *wins, *viewable_wins;
+    gboolean *viewable, *override_redirect;
+    unsigned int count, n_viewable, framed, i;
+    gint64 start, first_frame;
+    const gchar *operation;
 
     TRACE ("entering clientFrameAll");
 
     display_info = screen_info->display_info;
+    operation = setPropertyStatsOperation ("startup");
+    start = g_get_monotonic_time ();
+    first_frame = 0;
     clientSetFocus (screen_info, NULL, myDisplayGetCurrentTime (display_info), NO_FOCUS_FLAG);
     xfwmWindowTemp (screen_info,
                     NULL, 0,
@@ -2389,17 +2462,57 @@ clientFrameAll (ScreenInfo *screen_info)
                     FALSE);
 
     XSync (display_info->dpy, FALSE);
-    myDisplayGrabServer (display_info);
+    wins = NULL;
+    count = 0;
     XQueryTree (display_info->dpy, screen_info->xroot, &w1, &w2, &wins, &count);
+
+    /*
+     * Stage one, query the attributes and properties of all top-level
+     * windows at once, without grabbing the server. Changes made in the
+     * meantime are reported by PropertyNotify and processed once the
+     * windows are managed. Override redirect windows, our own included,
+     * are never managed so their event mask is left alone.
+     */
+    viewable = g_new0 (gboolean, count);
+    override_redirect = g_new0 (gboolean, count);
+    viewable_wins = g_new (Window, count);
+    client_query_viewable (display_info, wins, count, viewable, override_redirect);
+    n_viewable = 0;
+    gdk_error_trap_push ();
     for (i = 0; i < count; i++)
     {
-        XGetWindowAttributes (display_info->dpy, wins[i], &attr);
-        if ((attr.map_state == IsViewable) && (attr.root == screen_info->xroot))
+        if ((viewable[i]) && !(override_redirect[i]) &&
+            (wins[i] != screen_info->xfwm4_win) &&
+            (wins[i] != MYWINDOW_XWINDOW (shield)))
+        {
+            XSelectInput (display_info->dpy, wins[i], PropertyChangeMask | StructureNotifyMask);
+            viewable_wins[n_viewable++] = wins[i];
+        }
+    }
+    gdk_error_trap_pop ();
+    prefetchAllClientHints (display_info, viewable_wins, n_viewable);
+
+    /*
+     * Stage two, frame the windows in stacking order, bottom first.
+     * clientFrame() grabs the server for the whole framing of each window,
+     * one window at a time, so no single grab spans the entire startup.
+     */
+    framed = 0;
+    for (i = 0; i < count; i++)
+    {
+        if (viewable[i])
         {
             Client *c = clientFrame (display_info, wins[i], TRUE);
-            if ((c) && ((screen_info->params->raise_on_click) || (screen_info->params->click_to_focus)))
+            if (c)
             {
-                clientGrabMouseButton (c);
+                if (framed++ == 0)
+                {
+                    first_frame = g_get_monotonic_time ();
+                }
+                if ((screen_info->params->raise_on_click) || (screen_info->params->click_to_focus))
+                {
+                    clientGrabMouseButton (c);
+                }
             }
         }
         else
@@ -2407,14 +2520,26 @@ clientFrameAll (ScreenInfo *screen_info)
              compositorAddWindow (display_info, wins[i], NULL);
         }
     }
+    releasePrefetchedHints (display_info, None);
+    g_free (viewable_wins);
+    g_free (override_redirect);
+    g_free (viewable);
     if (wins)
     {
         XFree (wins);
     }
     clientFocusTop (screen_info, WIN_LAYER_FULLSCREEN, myDisplayGetCurrentTime (display_info));
     xfwmWindowDelete (&shield);
-    myDisplayUngrabServer (display_info);
     XSync (display_info->dpy, FALSE);
+    setPropertyStatsOperation (operation);
+
+    if (framed > 0)
+    {
+        g_message ("Screen %i: framed %u windows, first after %.1f ms, all after %.1f ms",
+                   screen_info->screen, framed,
+                   (first_frame - start) / 1000.0,
+                   (g_get_monotonic_time () - start) / 1000.0);
+    }
 }
 
 void
@@ -2496,6 +2621,31 @@ clientGetFromWindow (Client *c, Window w, unsigned short mode)
         }
     }
 
+    if (mode & SEARCH_FRAME_PART)
+    {
+        if (MYWINDOW_XWINDOW(c->title) == w)
+        {
+            TRACE ("found \"%s\" (mode FRAME_PART)", c->name);
+            return (c);
+        }
+        for (b = 0; b < SIDE_COUNT; b++)
+        {
+            if (MYWINDOW_XWINDOW(c->sides[b]) == w)
+            {
+                TRACE ("found \"%s\" (mode FRAME_PART)", c->name);
+                return (c);
+            }
+        }
+        for (b = 0; b < CORNER_COUNT; b++)
+        {
+            if (MYWINDOW_XWINDOW(c->corners[b]) == w)
+            {
+                TRACE ("found \"%s\" (mode FRAME_PART)", c->name);
+                return (c);
+            }
+        }
+    }
+
     TRACE ("no client found");
 
     return NULL;
@@ -2513,6 +2663,40 @@ clientWorkspaceLocked (Client *c)
         return FALSE;
 }
 
+/* the workspace a locked client belongs to, looked up by name once per policy change */
+static gboolean
+clientGetLockedWorkspace (Client *c, guint *ws)
+{
+    ScreenInfo *screen_info;
+
+    screen_info = c->screen_info;
+    if (c->sandbox_ws_serial != screen_info->workspace_policy_serial)
+    {
+        if (!workspaceGetFromName (screen_info, c->sandbox_workspace, &c->sandbox_ws))
+            c->sandbox_ws = G_MAXUINT;
+        c->sandbox_ws_serial = screen_info->workspace_policy_serial;
+    }
+    *ws = c->sandbox_ws;
+
+    return (c->sandbox_ws != G_MAXUINT);
+}
+
+/* whether a locked client may live in the given workspace */
+static gboolean
+clientLockedWorkspaceAllows (Client *c, guint ws)
+{
+    const WorkspacePolicy *policy;
+    guint parent_ws;
+
+    if (!clientGetLockedWorkspace (c, &parent_ws))
+        return FALSE;
+    if (workspaceGetPolicy (c->screen_info, parent_ws)->flags & WORKSPACE_POLICY_LET_SANDBOXED_OUT)
+        return TRUE;
+
+    policy = workspaceGetPolicy (c->screen_info, ws);
+    return (policy->flags & WORKSPACE_POLICY_SECURE) && (policy->name_index == parent_ws);
+}
+
 gboolean
 clientIsXfce (Client *c)
 {
@@ -2543,8 +2727,7 @@ clientIsXfce (Client *c)
 gboolean
 clientAllowedToShowInSandbox (Client *c, guint ws)
 {
-    guint parent_ws;
-    gboolean parent_lets_out = FALSE;
+    const WorkspacePolicy *policy;
 
     TRACE ("entering clientForbiddenToShowInSandbox");
 
@@ -2555,14 +2738,12 @@ clientAllowedToShowInSandbox (Client *c, guint ws)
     if (clientIsXfce (c))
         return TRUE;
     else if (clientWorkspaceLocked (c))
-    {
-        if (workspaceGetFromName (c->screen_info, c->sandbox_workspace, &parent_ws))
-            parent_lets_out = xfce_workspace_let_sandboxed_out (parent_ws);
-        return parent_lets_out || (xfce_workspace_is_secure (ws) && g_strcmp0 (c->sandbox_workspace, c->screen_info->workspace_names[ws]) == 0);
-    }
-    else if (!xfce_workspace_is_secure (ws))
+        return clientLockedWorkspaceAllows (c, ws);
+
+    policy = workspaceGetPolicy (c->screen_info, ws);
+    if (!(policy->flags & WORKSPACE_POLICY_SECURE))
         return TRUE;
-    else if (xfce_workspace_let_unsandboxed_in (ws) && (xfce_workspace_unsandboxed_in_behavior (ws) == XFCE_WORKSPACE_ENTER_UNSANDBOXED))
+    else if (policy->flags & WORKSPACE_POLICY_ENTER_UNSANDBOXED)
         return TRUE;
     else
         return FALSE;
@@ -2803,21 +2984,16 @@ clientSkipNextSecureWorkspace (Client *c, guint previous_ws, guint ws, gboolean
     gboolean goRight;
     gboolean compatible;
     guint next_ws;
-    guint parent_ws;
-    gboolean parent_lets_out = FALSE;
 
     TRACE ("entering clientSkipNextSecureWorkspace");
 
     goRight = clientShouldCycleUpwards (c, previous_ws, ws);
     next_ws = ws;
 
-    if (workspaceGetFromName (c->screen_info, c->sandbox_workspace, &parent_ws))
-        parent_lets_out = xfce_workspace_let_sandboxed_out (parent_ws);
-
     do
     {
         // check if compatible
-        compatible = parent_lets_out || (xfce_workspace_is_secure (next_ws) && g_strcmp0 (c->sandbox_workspace, c->screen_info->workspace_names[next_ws]) == 0);
+        compatible = clientLockedWorkspaceAllows (c, next_ws);
 
         if (compatible)
         {
@@ -2864,6 +3040,7 @@ clientSkipNextSecureWorkspace (Client *c, guint previous_ws, guint ws, gboolean
 static void
 clientSkipNextNormalWorkspace (Client *c, guint previous_ws, guint ws, gboolean manage_mapping, gboolean allow_skipping)
 {
+    const WorkspacePolicy *policy;
     gboolean goRight;
     guint next_ws;
 
@@ -2875,14 +3052,15 @@ clientSkipNextNormalWorkspace (Client *c, guint previous_ws, guint ws, gboolean
     do
     {
         // check if compatible
-        if (!xfce_workspace_is_secure (next_ws) ||
-            (xfce_workspace_let_unsandboxed_in (next_ws) && (xfce_workspace_unsandboxed_in_behavior (next_ws) == XFCE_WORKSPACE_ENTER_UNSANDBOXED)))
+        policy = workspaceGetPolicy (c->screen_info, next_ws);
+        if (!(policy->flags & WORKSPACE_POLICY_SECURE) ||
+            (policy->flags & WORKSPACE_POLICY_ENTER_UNSANDBOXED))
         {
             clientSetWorkspaceSingle (c, next_ws);
             clientManageMappingPostWorkspaceSwitch (c, previous_ws, next_ws, manage_mapping);
             return;
         }
-        else if (xfce_workspace_unsandboxed_in_behavior (next_ws) == XFCE_WORKSPACE_ENTER_REPLACE)
+        else if (policy->flags & WORKSPACE_POLICY_ENTER_REPLACE)
         {
             if (!(FLAG_TEST (c->flags, CLIENT_FLAG_STICKY)))
             {
@@ -2946,6 +3124,7 @@ clientSetWorkspace (Client *c, guint ws, gboolean manage_mapping, gboolean allow
         g_warning ("Requested workspace %d does not exist", ws);
         return;
     }
+    workspaceRefreshPolicy (c->screen_info);
 
     list_of_windows = clientListTransientOrModal (c);
     for (list = list_of_windows; list; list = g_list_next (list))
@@ -2964,7 +3143,7 @@ clientSetWorkspace (Client *c, guint ws, gboolean manage_mapping, gboolean allow
             }
 
             /* client is unsandboxed and requested workspace is for sandboxed clients */
-            else if (!isXfce && xfce_workspace_is_secure (ws))
+            else if (!isXfce && (workspaceGetPolicy (c2->screen_info, ws)->flags & WORKSPACE_POLICY_SECURE))
             {
                 clientSkipNextNormalWorkspace(c2, previous_ws, ws, manage_mapping, allow_skipping);
                 return;
@@ -3031,7 +3210,7 @@ clientShow (Client *c, gboolean deiconify)
 
     if (!clientAllowedToShowInSandbox (c, c->screen_info->current_ws))
     {
-        if (xfce_workspace_unsandboxed_in_behavior (c->screen_info->current_ws) == XFCE_WORKSPACE_ENTER_REPLACE)
+        if (workspaceGetPolicy (c->screen_info, c->screen_info->current_ws)->flags & WORKSPACE_POLICY_ENTER_REPLACE)
         {
             clientProposeSandboxing(c, c->win_workspace, c->screen_info->current_ws, "displayed");
         }
@@ -66,6 +66,7 @@
 #define CFG_NOTIFY                      (1<<2)
 #define CFG_KEEP_VISIBLE                (1<<3)
 #define CFG_FORCE_REDRAW                (1<<4)
+#define CFG_QUEUE_REDRAW                (1<<5)
 
 #define SEARCH_INCLUDE_HIDDEN           (1<<0)
 #define SEARCH_INCLUDE_SHADED           (1<<1)
@@ -179,6 +180,10 @@
 #define WM_FLAG_URGENT                  (1L<<4)
 #define WM_FLAG_PING                    (1L<<5)
 
+#define PENDING_PROP_NAME               (1L<<0)
+#define PENDING_PROP_OPACITY            (1L<<1)
+#define PENDING_PROP_STRUTS             (1L<<2)
+
 #define XFWM_FLAG_INITIAL_VALUES        XFWM_FLAG_HAS_BORDER | \
                                         XFWM_FLAG_HAS_MENU | \
                                         XFWM_FLAG_HAS_MAXIMIZE | \
@@ -310,6 +315,9 @@ struct _Client
     sandboxType sandboxed;
     char *sandbox_name;
     char *sandbox_workspace;
+    /* sandbox_workspace as an index, valid for workspace_policy_serial */
+    guint sandbox_ws;
+    guint sandbox_ws_serial;
     char *container_name;
     gint x;
     gint y;
@@ -339,12 +347,17 @@ struct _Client
     gint struts[STRUTS_SIZE];
     gchar *hostname;
     gchar *name;
+    /* Shaped layout of name, valid for font_serial, see frameCreateTitlePixmap() */
+    PangoLayout *title_layout;
+    guint title_layout_serial;
     guint32 user_time;
     GPid pid;
     guint32 ping_time;
     unsigned long flags;
     unsigned long wm_flags;
     unsigned long xfwm_flags;
+    /* Property changes not processed yet, see clientFlushPendingProps() */
+    unsigned long pending_props;
     gint fullscreen_monitors[4];
     gint frame_extents[SIDE_COUNT];
 
@@ -353,8 +366,8 @@ struct _Client
     gint dialog_fd;
     /* Timout for asynchronous icon update */
     guint icon_timeout_id;
-    /* Timout for asynchronous frame update */
-    guint frame_timeout_id;
+    /* Waiting in the display frame redraw queue */
+    gboolean frame_queued;
     /* Timout to manage blinking decorations for urgent windows */
     guint blink_timeout_id;
     /* Timout for asynchronous icon update */
@@ -423,6 +436,9 @@ void                     clientUnframeAll                       (ScreenInfo *);
 void                     clientInstallColormaps                 (Client *);
 void                     clientUpdateColormaps                  (Client *);
 void                     clientUpdateName                       (Client *);
+void                     clientQueuePropUpdate                  (Client *,
+                                                                 unsigned long);
+void                     clientFlushPendingProps                (DisplayInfo *);
 void                     clientUpdateAllFrames                  (ScreenInfo *,
                                                                  gboolean);
 void                     clientGrabButtons                      (Client *);
@@ -28,6 +28,7 @@
 
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
+#include <X11/Xregion.h>
 #include <X11/Xatom.h>
 #include <X11/extensions/shape.h>
 
@@ -92,8 +93,46 @@
 #define WIN_IS_DAMAGED(cw)              (cw->damaged)
 #define WIN_IS_REDIRECTED(cw)           (cw->redirected)
 
-/* Set TIMEOUT_REPAINT to 0 to disable timeout repaint */
-#define TIMEOUT_REPAINT       10 /* msec */
+/*
+ * TIMEOUT_REPAINT only switches the frame paced repaint scheduler on or off,
+ * the delay itself is computed from the refresh rate. Set it to 0 to repaint
+ * synchronously from the event loop instead.
+ */
+#define TIMEOUT_REPAINT       1
+
+/* Delay before a fullscreen window bypasses compositing */
+#define UNREDIRECT_DELAY      500 /* msec */
+
+/* Stale thumbnails are refreshed in the background at most that often */
+#define THUMBNAIL_REFRESH_DELAY 500 /* msec */
+#define THUMBNAIL_REFRESH_BATCH 4
+
+/* Opacity of the thumbnail of an iconified window */
+#define THUMBNAIL_ICONIFIED_ALPHA 0.55
+
+/* Frame pacing, all in usec */
+#define FRAME_INTERVAL_DEFAULT  16667 /* assume 60Hz until told otherwise */
+#define FRAME_INTERVAL_MIN       4000 /* 250Hz */
+#define FRAME_INTERVAL_MAX      50000 /* 20Hz */
+#define FRAME_PAINT_BUDGET       2000 /* time left for painting before vblank */
+
+/* Shadow opacity is quantized in 1/25th steps by the presummed tables */
+#define SHADOW_OPACITY_LEVELS 26
+
+/* The nine pieces shadows are assembled from, in row order */
+enum
+{
+    SHADOW_SLICE_TOP_LEFT = 0,
+    SHADOW_SLICE_TOP,
+    SHADOW_SLICE_TOP_RIGHT,
+    SHADOW_SLICE_LEFT,
+    SHADOW_SLICE_CENTER,
+    SHADOW_SLICE_RIGHT,
+    SHADOW_SLICE_BOTTOM_LEFT,
+    SHADOW_SLICE_BOTTOM,
+    SHADOW_SLICE_BOTTOM_RIGHT,
+    SHADOW_SLICE_COUNT
+};
 
 typedef struct _CWindow CWindow;
 struct _CWindow
@@ -124,10 +163,13 @@ struct _CWindow
     Picture shadowPict;
     Picture alphaBorderPict;
 
-    XserverRegion borderSize;
-    XserverRegion clientSize;
-    XserverRegion borderClip;
-    XserverRegion extents;
+    /* Client side regions, see the region helpers below */
+    Region shape;               /* bounding shape, kept until the next ShapeNotify */
+    Region borderSize;
+    Region clientSize;
+    Region borderClip;
+    Region extents;
+    Region visible;             /* extents not hidden by opaque windows above, see update_visible () */
 
     gint shadow_dx;
     gint shadow_dy;
@@ -135,24 +177,59 @@ struct _CWindow
     gint shadow_height;
 
     guint32 opacity;
+
+    /* Scaled down copy of the content, see get_window_thumbnail () */
+    Picture thumbnail;
+    guint thumbnail_width;
+    guint thumbnail_height;
+    guint thumbnail_scaled_width;
+    guint thumbnail_scaled_height;
+    gboolean thumbnail_stale;
 };
 
+/*
+ * Clipping and occlusion are computed in process using Xlib client side
+ * regions, only the resulting clip is ever sent to the server, which saves
+ * creating and destroying a server side XFixes region for each operation.
+ */
+static Region
+region_create_from_rect (XRectangle *r)
+{
+    Region region;
+
+    region = XCreateRegion ();
+    XUnionRectWithRegion (r, region, region);
+
+    return region;
+}
+
+static Region
+region_copy (Region src)
+{
+    Region region;
+
+    region = XCreateRegion ();
+    if (src)
+    {
+        XUnionRegion (src, region, region);
+    }
+
+    return region;
+}
+
 static CWindow*
 find_cwindow_in_screen (ScreenInfo *screen_info, Window id)
 {
-    GList *list;
+    CWindow *cw;
 
     g_return_val_if_fail (id != None, NULL);
     g_return_val_if_fail (screen_info != NULL, NULL);
     TRACE ("entering find_cwindow_in_screen");
 
-    for (list = screen_info->cwindows; list; list = g_list_next (list))
+    cw = g_hash_table_lookup (screen_info->display_info->cwindow_hash, GUINT_TO_POINTER (id));
+    if (cw && (cw->screen_info == screen_info))
     {
-        CWindow *cw = (CWindow *) list->data;
-        if (cw->id == id)
-        {
-            return cw;
-        }
+        return cw;
     }
     return NULL;
 }
@@ -160,22 +237,11 @@ find_cwindow_in_screen (ScreenInfo *screen_info, Window id)
 static CWindow*
 find_cwindow_in_display (DisplayInfo *display_info, Window id)
 {
-    GSList *list;
-
     g_return_val_if_fail (id != None, NULL);
     g_return_val_if_fail (display_info != NULL, NULL);
     TRACE ("entering find_cwindow_in_display");
 
-    for (list = display_info->screens; list; list = g_slist_next (list))
-    {
-        ScreenInfo *screen_info = (ScreenInfo *) list->data;
-        CWindow *cw = find_cwindow_in_screen (screen_info, id);
-        if (cw)
-        {
-            return (cw);
-        }
-    }
-    return NULL;
+    return (CWindow *) g_hash_table_lookup (display_info->cwindow_hash, GUINT_TO_POINTER (id));
 }
 
 static gboolean
@@ -243,127 +309,6 @@ is_fullscreen (CWindow *cw)
             (cw->attr.height + 2 * cw->attr.border_width == rect.height));
 }
 
-static gdouble
-gaussian (gdouble r, gdouble x, gdouble y)
-{
-    return ((1 / (sqrt (2 * G_PI * r))) *
-            exp ((- (x * x + y * y)) / (2 * r * r)));
-}
-
-static gaussian_conv *
-make_gaussian_map (gdouble r)
-{
-    gaussian_conv *c;
-    gint size, center;
-    gint x, y;
-    gdouble t;
-    gdouble g;
-
-    TRACE ("entering make_gaussian_map");
-
-    size = ((gint) ceil ((r * 3)) + 1) & ~1;
-    center = size / 2;
-    c = g_malloc (sizeof (gaussian_conv) + size * size * sizeof (gdouble));
-    c->size = size;
-    c->data = (gdouble *) (c + 1);
-    t = 0.0;
-
-    for (y = 0; y < size; y++)
-    {
-        for (x = 0; x < size; x++)
-        {
-            g = gaussian (r, (gdouble) (x - center), (gdouble) (y - center));
-            t += g;
-            c->data[y * size + x] = g;
-        }
-    }
-
-    for (y = 0; y < size; y++)
-    {
-        for (x = 0; x < size; x++)
-        {
-            c->data[y*size + x] /= t;
-        }
-    }
-
-    return c;
-}
-
-/*
-* A picture will help
-*
-*      -center   0                width  width+center
-*  -center +-----+-------------------+-----+
-*          |     |                   |     |
-*          |     |                   |     |
-*        0 +-----+-------------------+-----+
-*          |     |                   |     |
-*          |     |                   |     |
-*          |     |                   |     |
-*   height +-----+-------------------+-----+
-*          |     |                   |     |
-* height+  |     |                   |     |
-*  center  +-----+-------------------+-----+
-*/
-
-static guchar
-sum_gaussian (gaussian_conv *map, gdouble opacity, gint x, gint y, gint width, gint height)
-{
-    gdouble *g_data, *g_line;
-    gdouble v;
-    gint fx, fy;
-    gint fx_start, fx_end;
-    gint fy_start, fy_end;
-    gint g_size, center;
-
-    g_return_val_if_fail (map != NULL, (guchar) 255.0);
-    TRACE ("entering sum_gaussian");
-
-    g_line = map->data;
-    g_size = map->size;
-    center = g_size / 2;
-    fx_start = center - x;
-    if (fx_start < 0)
-    {
-        fx_start = 0;
-    }
-    fx_end = width + center - x;
-    if (fx_end > g_size)
-    {
-        fx_end = g_size;
-    }
-
-    fy_start = center - y;
-    if (fy_start < 0)
-    {
-        fy_start = 0;
-    }
-    fy_end = height + center - y;
-    if (fy_end > g_size)
-    {
-        fy_end = g_size;
-    }
-    g_line = g_line + fy_start * g_size + fx_start;
-
-    v = 0;
-    for (fy = fy_start; fy < fy_end; fy++)
-    {
-        g_data = g_line;
-        g_line += g_size;
-
-        for (fx = fx_start; fx < fx_end; fx++)
-        {
-            v += *g_data++;
-        }
-    }
-    if (v > 1)
-    {
-        v = 1;
-    }
-
-    return ((guchar) (v * opacity * 255.0));
-}
-
 /* precompute shadow corners and sides to save time for large windows */
 static void
 presum_gaussian (ScreenInfo *screen_info)
@@ -396,7 +341,7 @@ presum_gaussian (ScreenInfo *screen_info)
     for (x = 0; x <= screen_info->gaussianSize; x++)
     {
         screen_info->shadowTop[25 * (screen_info->gaussianSize + 1) + x] =
-            sum_gaussian (map, 1, x - center, center,
+            gaussianSum (map, 1, x - center, center,
                           screen_info->gaussianSize * 2,
                           screen_info->gaussianSize * 2);
 
@@ -411,7 +356,7 @@ presum_gaussian (ScreenInfo *screen_info)
             screen_info->shadowCorner[25 * (screen_info->gaussianSize + 1)
                                          * (screen_info->gaussianSize + 1)
                                      + y * (screen_info->gaussianSize + 1) + x]
-                = sum_gaussian (map, 1, x - center,
+                = gaussianSum (map, 1, x - center,
                                         y - center,
                                         screen_info->gaussianSize * 2,
                                         screen_info->gaussianSize * 2);
@@ -444,6 +389,7 @@ make_shadow (ScreenInfo *screen_info, gdouble opacity, gint width, gint height)
     DisplayInfo *display_info;
     XImage *ximage;
     guchar *data;
+    guchar *side;
     guchar d;
     gint gaussianSize;
     gint ylimit, xlimit;
@@ -494,7 +440,7 @@ make_shadow (ScreenInfo *screen_info, gdouble opacity, gint width, gint height)
     }
     else
     {
-        d = sum_gaussian (screen_info->gaussianMap, opacity, center, center, width, height);
+        d = gaussianSum (screen_info->gaussianMap, opacity, center, center, width, height);
     }
     memset(data, d, sheight * swidth);
 
@@ -524,7 +470,7 @@ make_shadow (ScreenInfo *screen_info, gdouble opacity, gint width, gint height)
             }
             else
             {
-                d = sum_gaussian (screen_info->gaussianMap, opacity,
+                d = gaussianSum (screen_info->gaussianMap, opacity,
                                 x - center, y - center, width, height);
             }
 
@@ -550,7 +496,7 @@ make_shadow (ScreenInfo *screen_info, gdouble opacity, gint width, gint height)
             }
             else
             {
-                d = sum_gaussian (screen_info->gaussianMap, opacity, center, y - center, width, height);
+                d = gaussianSum (screen_info->gaussianMap, opacity, center, y - center, width, height);
             }
             memset (&data[y * swidth + gaussianSize], d, x_diff);
             memset (&data[(sheight - y - 1) * swidth + gaussianSize], d, x_diff);
@@ -561,28 +507,159 @@ make_shadow (ScreenInfo *screen_info, gdouble opacity, gint width, gint height)
     * sides
     */
 
-    for (x = 0; x < xlimit; x++)
+    if (xlimit > 0 && sheight > 2 * gaussianSize)
     {
-        if (xlimit == screen_info->gaussianSize)
-        {
-            d = screen_info->shadowTop[opacity_int * (screen_info->gaussianSize + 1) + x];
-        }
-        else
+        /* Build one line of the sides and copy it row by row */
+        side = g_malloc (2 * xlimit * sizeof (guchar));
+        for (x = 0; x < xlimit; x++)
         {
-            d = sum_gaussian (screen_info->gaussianMap, opacity, x - center, center, width, height);
+            if (xlimit == screen_info->gaussianSize)
+            {
+                d = screen_info->shadowTop[opacity_int * (screen_info->gaussianSize + 1) + x];
+            }
+            else
+            {
+                d = gaussianSum (screen_info->gaussianMap, opacity, x - center, center, width, height);
+            }
+            side[x] = d;
+            side[2 * xlimit - x - 1] = d;
         }
-        x_swidth = swidth - x - 1;
+        x_swidth = swidth - xlimit;
         for (y = gaussianSize; y < sheight - gaussianSize; y++)
         {
             y_swidth = y * swidth;
-            data[y_swidth + x] = d;
-            data[y_swidth + x_swidth] = d;
+            memcpy (&data[y_swidth], side, xlimit);
+            memcpy (&data[y_swidth + x_swidth], &side[xlimit], xlimit);
         }
+        g_free (side);
     }
 
     return ximage;
 }
 
+/*
+ * Gives the position in the template shadow and in the final shadow, and the
+ * length of the given column (or row) of slices, 0 being the left (or top) one.
+ */
+static void
+shadow_slice_span (gint index, gint gaussianSize, gint total, gint *src, gint *dst, gint *len)
+{
+    switch (index)
+    {
+        case 0:
+            *src = 0;
+            *dst = 0;
+            *len = gaussianSize;
+            break;
+        case 1:
+            *src = gaussianSize;
+            *dst = gaussianSize;
+            *len = total - 2 * gaussianSize;
+            break;
+        default:
+            *src = gaussianSize + 1;
+            *dst = total - gaussianSize;
+            *len = gaussianSize;
+            break;
+    }
+}
+
+/*
+ * Once a shadow is larger than the gaussian, its corners only depend on the
+ * opacity and its edges and center are made of constant lines, so a template
+ * of (2 * gaussianSize + 1) pixels square holds all there is to know about it.
+ * The template is cut in nine repeating pictures which are uploaded once per
+ * opacity level and kept until the screen is unmanaged.
+ */
+static Picture *
+get_shadow_slices (ScreenInfo *screen_info, gdouble opacity, gint opacity_int)
+{
+    DisplayInfo *display_info;
+    XRenderPictureAttributes pa;
+    XRenderPictFormat *render_format;
+    XImage *shadowImage;
+    Pixmap pixmap;
+    Picture *slices;
+    GC gc;
+    gint gaussianSize;
+    gint sx, sy, dx, dy, w, h;
+    gint i;
+
+    g_return_val_if_fail (screen_info != NULL, NULL);
+    g_return_val_if_fail (screen_info->shadowSlices != NULL, NULL);
+    g_return_val_if_fail (opacity_int >= 0 && opacity_int < SHADOW_OPACITY_LEVELS, NULL);
+
+    slices = &screen_info->shadowSlices[opacity_int * SHADOW_SLICE_COUNT];
+    if (slices[SHADOW_SLICE_TOP_LEFT] != None)
+    {
+        return slices;
+    }
+
+    TRACE ("entering get_shadow_slices, opacity level %i", opacity_int);
+
+    display_info = screen_info->display_info;
+    render_format = XRenderFindStandardFormat (display_info->dpy, PictStandardA8);
+    g_return_val_if_fail (render_format != NULL, NULL);
+
+    gaussianSize = screen_info->gaussianSize;
+    shadowImage = make_shadow (screen_info, opacity,
+                               gaussianSize + 1 + screen_info->params->shadow_delta_width
+                                                + screen_info->params->shadow_delta_x,
+                               gaussianSize + 1 + screen_info->params->shadow_delta_height
+                                                + screen_info->params->shadow_delta_y);
+    if (shadowImage == NULL)
+    {
+        return NULL;
+    }
+
+    gc = NULL;
+    pa.repeat = True;
+    for (i = 0; i < SHADOW_SLICE_COUNT; i++)
+    {
+        shadow_slice_span (i % 3, gaussianSize, shadowImage->width, &sx, &dx, &w);
+        shadow_slice_span (i / 3, gaussianSize, shadowImage->height, &sy, &dy, &h);
+
+        pixmap = XCreatePixmap (display_info->dpy, screen_info->output, w, h, 8);
+        if (gc == NULL)
+        {
+            gc = XCreateGC (display_info->dpy, pixmap, 0, NULL);
+        }
+        XPutImage (display_info->dpy, pixmap, gc, shadowImage, sx, sy, 0, 0, w, h);
+        slices[i] = XRenderCreatePicture (display_info->dpy, pixmap,
+                                          render_format, CPRepeat, &pa);
+        XFreePixmap (display_info->dpy, pixmap);
+    }
+
+    XFreeGC (display_info->dpy, gc);
+    XDestroyImage (shadowImage);
+
+    return slices;
+}
+
+static void
+free_shadow_slices (ScreenInfo *screen_info)
+{
+    DisplayInfo *display_info;
+    gint i;
+
+    g_return_if_fail (screen_info != NULL);
+    TRACE ("entering free_shadow_slices");
+
+    display_info = screen_info->display_info;
+    if (screen_info->shadowSlices)
+    {
+        for (i = 0; i < SHADOW_OPACITY_LEVELS * SHADOW_SLICE_COUNT; i++)
+        {
+            if (screen_info->shadowSlices[i])
+            {
+                XRenderFreePicture (display_info->dpy, screen_info->shadowSlices[i]);
+            }
+        }
+        g_free (screen_info->shadowSlices);
+        screen_info->shadowSlices = NULL;
+    }
+}
+
 static Picture
 shadow_picture (ScreenInfo *screen_info, gdouble opacity,
                 gint width, gint height, gint *wp, gint *hp)
@@ -592,7 +669,11 @@ shadow_picture (ScreenInfo *screen_info, gdouble opacity,
     Pixmap shadowPixmap;
     Picture shadowPicture;
     XRenderPictFormat *render_format;
+    Picture *slices;
     GC gc;
+    gint gaussianSize;
+    gint swidth, sheight;
+    gint opacity_int;
 
     g_return_val_if_fail (screen_info != NULL, None);
     TRACE ("entering shadow_picture");
@@ -601,6 +682,47 @@ shadow_picture (ScreenInfo *screen_info, gdouble opacity,
     render_format = XRenderFindStandardFormat (display_info->dpy, PictStandardA8);
     g_return_val_if_fail (render_format != NULL, None);
 
+    gaussianSize = screen_info->gaussianSize;
+    swidth = width + gaussianSize - screen_info->params->shadow_delta_width - screen_info->params->shadow_delta_x;
+    sheight = height + gaussianSize - screen_info->params->shadow_delta_height - screen_info->params->shadow_delta_y;
+    opacity_int = (gint) (opacity * 25);
+
+    /* Large enough shadows are assembled from the cached slices, without any upload */
+    slices = NULL;
+    if ((gaussianSize > 0) && (swidth >= 2 * gaussianSize) && (sheight >= 2 * gaussianSize) &&
+        (opacity_int >= 0) && (opacity_int < SHADOW_OPACITY_LEVELS))
+    {
+        slices = get_shadow_slices (screen_info, opacity, opacity_int);
+    }
+
+    if (slices)
+    {
+        gint sx, sy, x, y, w, h;
+        gint i;
+
+        shadowPixmap = XCreatePixmap (display_info->dpy, screen_info->output,
+                                      swidth, sheight, 8);
+        shadowPicture = XRenderCreatePicture (display_info->dpy,
+                                              shadowPixmap, render_format, 0, NULL);
+        XFreePixmap (display_info->dpy, shadowPixmap);
+
+        for (i = 0; i < SHADOW_SLICE_COUNT; i++)
+        {
+            shadow_slice_span (i % 3, gaussianSize, swidth, &sx, &x, &w);
+            shadow_slice_span (i / 3, gaussianSize, sheight, &sy, &y, &h);
+            if ((w > 0) && (h > 0))
+            {
+                XRenderComposite (display_info->dpy, PictOpSrc, slices[i], None,
+                                  shadowPicture, 0, 0, 0, 0, x, y, w, h);
+            }
+        }
+
+        *wp = swidth;
+        *hp = sheight;
+
+        return shadowPicture;
+    }
+
     shadowImage = make_shadow (screen_info, opacity, width, height);
     if (shadowImage == NULL)
     {
@@ -687,19 +809,15 @@ solid_picture (ScreenInfo *screen_info, gboolean argb,
     return picture;
 }
 
-static XserverRegion
+static Region
 client_size (CWindow *cw)
 {
-    DisplayInfo *display_info;
-    ScreenInfo *screen_info;
-    XserverRegion border;
+    Region border;
 
-    g_return_val_if_fail (cw != NULL, None);
+    g_return_val_if_fail (cw != NULL, NULL);
     TRACE ("entering client_size");
 
-    screen_info = cw->screen_info;
-    display_info = screen_info->display_info;
-    border = None;
+    border = NULL;
 
     if (WIN_HAS_FRAME(cw))
     {
@@ -711,31 +829,63 @@ client_size (CWindow *cw)
         r.y = frameY (c) + frameTop (c);
         r.width = frameWidth (c) - frameLeft (c) - frameRight (c);
         r.height = frameHeight (c) - frameTop (c) - frameBottom (c);
-        border = XFixesCreateRegion (display_info->dpy, &r, 1);
+        border = region_create_from_rect (&r);
     }
 
     return border;
 }
 
-static XserverRegion
+static Region
 border_size (CWindow *cw)
 {
     DisplayInfo *display_info;
     ScreenInfo *screen_info;
-    XserverRegion border;
+    Region border;
+    XRectangle r;
 
-    g_return_val_if_fail (cw != NULL, None);
+    g_return_val_if_fail (cw != NULL, NULL);
     TRACE ("entering border_size");
 
     screen_info = cw->screen_info;
     display_info = screen_info->display_info;
-    border = XFixesCreateRegionFromWindow (display_info->dpy,
-                                           cw->id, WindowRegionBounding);
-    g_return_val_if_fail (border != None, None);
-    XFixesSetPictureClipRegion (display_info->dpy, cw->picture, 0, 0, border);
-    XFixesTranslateRegion (display_info->dpy, border,
-                           cw->attr.x + cw->attr.border_width,
-                           cw->attr.y + cw->attr.border_width);
+
+    if ((cw->shaped) && (display_info->have_shape))
+    {
+        XRectangle *rects;
+        int count, ordering, i;
+
+        /* Only fetched again once the shape or the size has changed */
+        if (cw->shape == NULL)
+        {
+            cw->shape = XCreateRegion ();
+            rects = XShapeGetRectangles (display_info->dpy, cw->id, ShapeBounding, &count, &ordering);
+            if (rects)
+            {
+                for (i = 0; i < count; i++)
+                {
+                    XUnionRectWithRegion (&rects[i], cw->shape, cw->shape);
+                }
+                XFree (rects);
+            }
+        }
+        border = region_copy (cw->shape);
+    }
+    else
+    {
+        r.x = - cw->attr.border_width;
+        r.y = - cw->attr.border_width;
+        r.width = cw->attr.width + 2 * cw->attr.border_width;
+        r.height = cw->attr.height + 2 * cw->attr.border_width;
+        border = region_create_from_rect (&r);
+    }
+
+    if (cw->picture)
+    {
+        XRenderSetPictureClipRegion (display_info->dpy, cw->picture, border);
+    }
+    XOffsetRegion (border,
+                   cw->attr.x + cw->attr.border_width,
+                   cw->attr.y + cw->attr.border_width);
 
     return border;
 }
@@ -800,31 +950,50 @@ free_win_data (CWindow *cw, gboolean delete)
 
     if (cw->borderSize)
     {
-        XFixesDestroyRegion (display_info->dpy, cw->borderSize);
-        cw->borderSize = None;
+        XDestroyRegion (cw->borderSize);
+        cw->borderSize = NULL;
     }
 
     if (cw->clientSize)
     {
-        XFixesDestroyRegion (display_info->dpy, cw->clientSize);
-        cw->clientSize = None;
+        XDestroyRegion (cw->clientSize);
+        cw->clientSize = NULL;
     }
 
     if (cw->borderClip)
     {
-        XFixesDestroyRegion (display_info->dpy, cw->borderClip);
-        cw->borderClip = None;
+        XDestroyRegion (cw->borderClip);
+        cw->borderClip = NULL;
     }
 
     if (cw->extents)
     {
-        XFixesDestroyRegion (display_info->dpy, cw->extents);
-        cw->extents = None;
+        XDestroyRegion (cw->extents);
+        cw->extents = NULL;
+    }
+
+    if (cw->visible)
+    {
+        XDestroyRegion (cw->visible);
+        cw->visible = NULL;
     }
+    screen_info->clipChanged = TRUE;
 
     if (delete)
     {
+        if (cw->shape)
+        {
+            XDestroyRegion (cw->shape);
+            cw->shape = NULL;
+        }
+
         /* No need to keep this around */
+        if (cw->thumbnail)
+        {
+            XRenderFreePicture (display_info->dpy, cw->thumbnail);
+            cw->thumbnail = None;
+        }
+
         if (cw->saved_picture)
         {
             XRenderFreePicture (display_info->dpy, cw->saved_picture);
@@ -1002,6 +1171,33 @@ cursor_to_picture (ScreenInfo *screen_info, XFixesCursorImage *cursor)
     return picture;
 }
 
+#if defined (HAVE_EPOXY) || defined (HAVE_PRESENT_EXTENSION)
+/*
+ * Records a vblank that just happened, the ust and msc given by the server
+ * or the driver are only used to refine the refresh interval, the phase is
+ * taken from our own clock as ust is not guaranteed to be on the same base.
+ */
+static void
+update_frame_timing (ScreenInfo *screen_info, guint64 ust, guint64 msc)
+{
+    gint64 interval;
+
+    g_return_if_fail (screen_info != NULL);
+
+    if ((msc > screen_info->last_msc) && (ust > screen_info->last_ust) && (screen_info->last_msc > 0))
+    {
+        interval = (gint64) ((ust - screen_info->last_ust) / (msc - screen_info->last_msc));
+        if ((interval >= FRAME_INTERVAL_MIN) && (interval <= FRAME_INTERVAL_MAX))
+        {
+            screen_info->frame_interval = interval;
+        }
+    }
+    screen_info->last_ust = ust;
+    screen_info->last_msc = msc;
+    screen_info->last_vblank_time = g_get_monotonic_time ();
+}
+#endif /* HAVE_EPOXY || HAVE_PRESENT_EXTENSION */
+
 #ifdef HAVE_EPOXY
 static gboolean
 check_gl_error (void)
@@ -1403,11 +1599,13 @@ wait_glx_vblank (ScreenInfo *screen_info)
                           screen_info->glx_window,
                           0, 2, (msc + 1) % 2,
                           &ust, &msc, &sbc);
+        update_frame_timing (screen_info, (guint64) ust, (guint64) msc);
     }
     else if (screen_info->has_glx_video_sync)
     {
         glXGetVideoSyncSGI (&current_count);
         glXWaitVideoSyncSGI (2, (current_count + 1) % 2, &current_count);
+        screen_info->last_vblank_time = g_get_monotonic_time ();
     }
 }
 
@@ -1579,31 +1777,50 @@ redraw_glx_texture (ScreenInfo *screen_info)
 #endif /* HAVE_EPOXY */
 
 #ifdef HAVE_PRESENT_EXTENSION
+/*
+ * The update region is copied into the same server region for every flip,
+ * a single request instead of creating and destroying one each frame.
+ */
 static void
-present_flip (ScreenInfo *screen_info, XserverRegion region, Pixmap pixmap)
+present_flip (ScreenInfo *screen_info, Region region, Pixmap pixmap)
 {
     static guint32 present_serial;
+    Display *dpy;
+    XRectangle *rects;
+    long i;
 
     g_return_if_fail (screen_info != NULL);
-    g_return_if_fail (region != None);
+    g_return_if_fail (region != NULL);
     g_return_if_fail (pixmap != None);
 
     TRACE ("entering present_flip (serial %d)", present_serial);
 
-    XPresentPixmap (myScreenGetXDisplay (screen_info), screen_info->output,
-                    pixmap, present_serial++, None, region, 0, 0, None, None, None,
-                    PresentOptionNone, 0, 1, 0, NULL, 0);
+    dpy = myScreenGetXDisplay (screen_info);
+    rects = g_new (XRectangle, MAX (region->numRects, 1));
+    for (i = 0; i < region->numRects; i++)
+    {
+        rects[i].x = region->rects[i].x1;
+        rects[i].y = region->rects[i].y1;
+        rects[i].width = region->rects[i].x2 - region->rects[i].x1;
+        rects[i].height = region->rects[i].y2 - region->rects[i].y1;
+    }
+    XFixesSetRegion (dpy, screen_info->present_region, rects, (int) region->numRects);
+    g_free (rects);
+
+    XPresentPixmap (dpy, screen_info->output,
+                    pixmap, present_serial++, None, screen_info->present_region,
+                    0, 0, None, None, None, PresentOptionNone, 0, 1, 0, NULL, 0);
 }
 #endif /* HAVE_PRESENT_EXTENSION */
 
-static XserverRegion
+static Region
 win_extents (CWindow *cw)
 {
     DisplayInfo *display_info;
     ScreenInfo *screen_info;
     XRectangle r;
 
-    g_return_val_if_fail (cw != NULL, None);
+    g_return_val_if_fail (cw != NULL, NULL);
     TRACE ("entering win_extents: 0x%lx", cw->id);
 
     screen_info = cw->screen_info;
@@ -1685,7 +1902,8 @@ win_extents (CWindow *cw)
         XRenderFreePicture (display_info->dpy, cw->shadow);
         cw->shadow = None;
     }
-    return XFixesCreateRegion (display_info->dpy, &r, 1);
+
+    return region_create_from_rect (&r);
 }
 
 static void
@@ -1810,10 +2028,10 @@ paint_root (ScreenInfo *screen_info, Picture paint_buffer)
 }
 
 static void
-paint_cursor (ScreenInfo *screen_info, XserverRegion region, Picture paint_buffer)
+paint_cursor (ScreenInfo *screen_info, Region region, Picture paint_buffer)
 {
-    XFixesSetPictureClipRegion (myScreenGetXDisplay (screen_info),
-                                paint_buffer, 0, 0, region);
+    XRenderSetPictureClipRegion (myScreenGetXDisplay (screen_info),
+                                 paint_buffer, region);
     XRenderComposite (myScreenGetXDisplay (screen_info),
                       PictOpOver,
                       screen_info->cursorPicture,
@@ -1826,7 +2044,7 @@ paint_cursor (ScreenInfo *screen_info, XserverRegion region, Picture paint_buffe
 }
 
 static void
-paint_win (CWindow *cw, XserverRegion region, Picture paint_buffer, gboolean solid_part)
+paint_win (CWindow *cw, Region region, Picture paint_buffer, gboolean solid_part)
 {
     ScreenInfo *screen_info;
     DisplayInfo *display_info;
@@ -1906,23 +2124,28 @@ paint_win (CWindow *cw, XserverRegion region, Picture paint_buffer, gboolean sol
         if (paint_solid)
         {
             XRectangle  r;
-            XserverRegion client_region;
-
-            XFixesSetPictureClipRegion (display_info->dpy, paint_buffer, 0, 0, region);
-            XRenderComposite (display_info->dpy, PictOpSrc, cw->picture, None,
-                              paint_buffer,
-                              frame_left, frame_top,
-                              0, 0,
-                              frame_x + frame_left, frame_y + frame_top,
-                              frame_width - frame_left - frame_right, frame_height - frame_top - frame_bottom);
+            Region client_region;
 
             r.x = frame_x + frame_left;
             r.y = frame_y + frame_top;
             r.width = frame_width - frame_left - frame_right;
             r.height = frame_height - frame_top - frame_bottom;
-            client_region = XFixesCreateRegion (display_info->dpy, &r, 1);
-            XFixesSubtractRegion (display_info->dpy, region, region, client_region);
-            XFixesDestroyRegion (display_info->dpy, client_region);
+            client_region = region_create_from_rect (&r);
+
+            /* Only send the part of the clip that will actually be painted */
+            XIntersectRegion (region, client_region, client_region);
+            if (!XEmptyRegion (client_region))
+            {
+                XRenderSetPictureClipRegion (display_info->dpy, paint_buffer, client_region);
+                XRenderComposite (display_info->dpy, PictOpSrc, cw->picture, None,
+                                  paint_buffer,
+                                  frame_left, frame_top,
+                                  0, 0,
+                                  frame_x + frame_left, frame_y + frame_top,
+                                  frame_width - frame_left - frame_right, frame_height - frame_top - frame_bottom);
+                XSubtractRegion (region, client_region, region);
+            }
+            XDestroyRegion (client_region);
         }
         else if (!solid_part)
         {
@@ -1942,12 +2165,21 @@ paint_win (CWindow *cw, XserverRegion region, Picture paint_buffer, gboolean sol
         get_paint_bounds (cw, &x, &y, &w, &h);
         if (paint_solid)
         {
-            XFixesSetPictureClipRegion (display_info->dpy, paint_buffer, 0, 0, region);
-            XRenderComposite (display_info->dpy, PictOpSrc,
-                              cw->picture, None,
-                              paint_buffer,
-                              0, 0, 0, 0, x, y, w, h);
-            XFixesSubtractRegion (display_info->dpy, region, region, cw->borderSize);
+            Region clip;
+
+            /* Only send the part of the clip that will actually be painted */
+            clip = XCreateRegion ();
+            XIntersectRegion (region, cw->borderSize, clip);
+            if (!XEmptyRegion (clip))
+            {
+                XRenderSetPictureClipRegion (display_info->dpy, paint_buffer, clip);
+                XRenderComposite (display_info->dpy, PictOpSrc,
+                                  cw->picture, None,
+                                  paint_buffer,
+                                  0, 0, 0, 0, x, y, w, h);
+                XSubtractRegion (region, clip, region);
+            }
+            XDestroyRegion (clip);
         }
         else if (!solid_part)
         {
@@ -1959,17 +2191,134 @@ paint_win (CWindow *cw, XserverRegion region, Picture paint_buffer, gboolean sol
     }
 }
 
+/*
+ * On SIGUSR1 the statistics are also exposed as a CARDINAL[8]
+ * XFWM4_COMPOSITOR_STATS property on the root window, which
+ * `xprop -root XFWM4_COMPOSITOR_STATS` can read:
+ * frames, last paint usec, max paint usec, average paint usec, windows
+ * painted, windows skipped, damage area and X requests of the last frame.
+ */
 static void
-paint_all (ScreenInfo *screen_info, XserverRegion region, gushort buffer)
+publish_stats (ScreenInfo *screen_info)
+{
+    compositor_stats *stats;
+    long data[8];
+
+    stats = &screen_info->stats;
+    data[0] = (long) stats->frames;
+    data[1] = (long) stats->paint_time;
+    data[2] = (long) stats->max_paint_time;
+    data[3] = (long) (stats->frames ? stats->total_paint_time / stats->frames : 0);
+    data[4] = (long) stats->windows_painted;
+    data[5] = (long) stats->windows_skipped;
+    data[6] = (long) stats->damage_area;
+    data[7] = (long) stats->requests;
+
+    XChangeProperty (myScreenGetXDisplay (screen_info), screen_info->xroot,
+                     screen_info->display_info->atoms[XFWM4_COMPOSITOR_STATS],
+                     XA_CARDINAL, 32, PropModeReplace, (unsigned char *) data, 8);
+}
+
+static void
+update_stats (ScreenInfo *screen_info, gint64 start, gulong request,
+              guint painted, guint skipped, guint64 area)
+{
+    compositor_stats *stats;
+    gint64 now;
+
+    stats = &screen_info->stats;
+    now = g_get_monotonic_time ();
+
+    stats->frames++;
+    stats->paint_time = now - start;
+    stats->max_paint_time = MAX (stats->max_paint_time, stats->paint_time);
+    stats->total_paint_time += stats->paint_time;
+    stats->windows_painted = painted;
+    stats->windows_skipped = skipped;
+    stats->damage_area = area;
+    stats->requests = NextRequest (myScreenGetXDisplay (screen_info)) - request;
+}
+
+/*
+ * Computes the part of each window's extents that is not hidden by the
+ * opaque windows above it. This only depends on the stacking, geometry,
+ * shape and opacity of the windows, so it is kept until one of those
+ * changes, which sets clipChanged, instead of being computed at each frame.
+ */
+static void
+update_visible (ScreenInfo *screen_info)
+{
+    GList *list;
+    Region covered;
+    CWindow *cw;
+
+    TRACE ("entering update_visible");
+
+    covered = XCreateRegion ();
+    for (list = screen_info->cwindows; list; list = g_list_next (list))
+    {
+        cw = (CWindow *) list->data;
+        if (cw->visible)
+        {
+            XDestroyRegion (cw->visible);
+            cw->visible = NULL;
+        }
+
+        /* Same as paint_all (), only the windows painted can hide others */
+        if (!WIN_IS_VISIBLE(cw) || !WIN_IS_DAMAGED(cw) || !WIN_IS_REDIRECTED(cw))
+        {
+            continue;
+        }
+
+        if (cw->extents == NULL)
+        {
+            cw->extents = win_extents (cw);
+        }
+        cw->visible = XCreateRegion ();
+        XSubtractRegion (cw->extents, covered, cw->visible);
+
+        if (WIN_IS_OPAQUE(cw))
+        {
+            if (cw->borderSize == NULL)
+            {
+                cw->borderSize = border_size (cw);
+            }
+            if (cw->clientSize == NULL)
+            {
+                cw->clientSize = client_size (cw);
+            }
+            /* The frame may be translucent, only count on the client area then */
+            if (cw->clientSize)
+            {
+                XUnionRegion (covered, cw->clientSize, covered);
+            }
+            else if (cw->borderSize)
+            {
+                XUnionRegion (covered, cw->borderSize, covered);
+            }
+        }
+    }
+    XDestroyRegion (covered);
+
+    screen_info->clipChanged = FALSE;
+}
+
+static void
+paint_all (ScreenInfo *screen_info, Region region, gushort buffer)
 {
     DisplayInfo *display_info;
-    XserverRegion paint_region;
+    Region paint_region;
     Picture paint_buffer;
     Display *dpy;
-    GList *list;
+    GList *list, *last;
     gint screen_width;
     gint screen_height;
+    XRectangle r;
     CWindow *cw;
+    gint64 paint_start;
+    gulong paint_request;
+    guint painted, skipped;
+    guint64 damage_area;
 
     TRACE ("entering paint_all buffer %d", buffer);
     g_return_if_fail (screen_info);
@@ -1979,6 +2328,13 @@ paint_all (ScreenInfo *screen_info, XserverRegion region, gushort buffer)
     screen_width = screen_info->width;
     screen_height = screen_info->height;
 
+    paint_start = g_get_monotonic_time ();
+    paint_request = NextRequest (dpy);
+    painted = 0;
+    skipped = 0;
+    XClipBox (region, &r);
+    damage_area = (guint64) r.width * r.height;
+
     /* Create root buffer if not done yet */
     if (screen_info->rootPixmap[buffer] == None)
     {
@@ -2008,17 +2364,35 @@ paint_all (ScreenInfo *screen_info, XserverRegion region, gushort buffer)
         paint_buffer = screen_info->rootBuffer[buffer];
     }
     /* Copy the original given region */
-    paint_region = XFixesCreateRegion (dpy, NULL, 0);
-    XFixesCopyRegion (dpy, paint_region, region);
+    paint_region = region_copy (region);
+
+    if (screen_info->clipChanged)
+    {
+        update_visible (screen_info);
+    }
 
     /*
      * Painting from top to bottom, reducing the clipping area at each iteration.
      * Only the opaque windows are painted 1st.
+     *
+     * Windows whose visible part does not intersect what remains of the damage
+     * are left out, and once opaque windows cover the whole damage, nothing
+     * below can show through so the walk stops there, leaving out the remaining
+     * windows and the root.
      */
+    last = NULL;
     for (list = screen_info->cwindows; list; list = g_list_next (list))
     {
+        if (XEmptyRegion (paint_region))
+        {
+            TRACE ("damage fully covered, stopping");
+            break;
+        }
+        last = list;
+
         cw = (CWindow *) list->data;
         TRACE ("painting forward 0x%lx", cw->id);
+
         if (!WIN_IS_VISIBLE(cw) || !WIN_IS_DAMAGED(cw))
         {
             TRACE ("skipped, not damaged or not viewable 0x%lx", cw->id);
@@ -2041,19 +2415,29 @@ paint_all (ScreenInfo *screen_info, XserverRegion region, gushort buffer)
             continue;
         }
 
-        if (cw->extents == None)
+        /* update_visible () has set the visible part of all windows painted */
+        if ((cw->visible == NULL) || XEmptyRegion (cw->visible))
         {
-            cw->extents = win_extents (cw);
+            TRACE ("skipped, occluded 0x%lx", cw->id);
+            cw->skipped = TRUE;
+            continue;
+        }
+        XClipBox (cw->visible, &r);
+        if (XRectInRegion (paint_region, r.x, r.y, r.width, r.height) == RectangleOut)
+        {
+            TRACE ("skipped, not in damaged area 0x%lx", cw->id);
+            cw->skipped = TRUE;
+            continue;
         }
         if (cw->picture == None)
         {
             cw->picture = get_window_picture (cw);
         }
-        if (cw->borderSize == None)
+        if (cw->borderSize == NULL)
         {
             cw->borderSize = border_size (cw);
         }
-        if (cw->clientSize == None)
+        if (cw->clientSize == NULL)
         {
             cw->clientSize = client_size (cw);
         }
@@ -2061,50 +2445,58 @@ paint_all (ScreenInfo *screen_info, XserverRegion region, gushort buffer)
         {
             paint_win (cw, paint_region, paint_buffer, TRUE);
         }
-        if (cw->borderClip == None)
+        if (cw->borderClip == NULL)
         {
-            cw->borderClip = XFixesCreateRegion (dpy, NULL, 0);
-            XFixesCopyRegion (dpy, cw->borderClip, paint_region);
+            cw->borderClip = region_copy (paint_region);
         }
 
         cw->skipped = FALSE;
     }
 
     /*
-     * region has changed because of the XFixesSubtractRegion (),
+     * region has changed because of the XSubtractRegion (),
      * reapply clipping for the last iteration.
      */
-    XFixesSetPictureClipRegion (dpy, paint_buffer, 0, 0, paint_region);
-    paint_root (screen_info, paint_buffer);
+    if (!XEmptyRegion (paint_region))
+    {
+        XRenderSetPictureClipRegion (dpy, paint_buffer, paint_region);
+        paint_root (screen_info, paint_buffer);
+    }
 
     /*
-     * Painting from bottom to top, translucent windows and shadows are painted now...
+     * Painting from bottom to top, translucent windows and shadows are painted now,
+     * starting from the last window reached above.
      */
-    for (list = g_list_last(screen_info->cwindows); list; list = g_list_previous (list))
+    for (list = last; list; list = g_list_previous (list))
     {
-        XserverRegion shadowClip;
+        Region shadowClip;
 
         cw = (CWindow *) list->data;
-        shadowClip = None;
+        shadowClip = NULL;
         TRACE ("painting backward 0x%lx", cw->id);
 
         if (cw->skipped)
         {
             TRACE ("skipped 0x%lx", cw->id);
+            skipped++;
             continue;
         }
+        painted++;
 
         if (cw->shadow)
         {
-            shadowClip = XFixesCreateRegion (dpy, NULL, 0);
-            XFixesSubtractRegion (dpy, shadowClip, cw->borderClip, cw->borderSize);
-
-            XFixesSetPictureClipRegion (dpy, paint_buffer, 0, 0, shadowClip);
-            XRenderComposite (dpy, PictOpOver, screen_info->blackPicture, cw->shadow,
-                              paint_buffer, 0, 0, 0, 0,
-                              cw->attr.x + cw->shadow_dx,
-                              cw->attr.y + cw->shadow_dy,
-                              cw->shadow_width, cw->shadow_height);
+            shadowClip = XCreateRegion ();
+            XSubtractRegion (cw->borderClip, cw->borderSize, shadowClip);
+
+            if (!XEmptyRegion (shadowClip))
+            {
+                XRenderSetPictureClipRegion (dpy, paint_buffer, shadowClip);
+                XRenderComposite (dpy, PictOpOver, screen_info->blackPicture, cw->shadow,
+                                  paint_buffer, 0, 0, 0, 0,
+                                  cw->attr.x + cw->shadow_dx,
+                                  cw->attr.y + cw->shadow_dy,
+                                  cw->shadow_width, cw->shadow_height);
+            }
         }
 
         if (cw->picture)
@@ -2117,28 +2509,29 @@ paint_all (ScreenInfo *screen_info, XserverRegion region, gushort buffer)
                                                0.0, /* green */
                                                0.0  /* blue  */);
             }
-            XFixesIntersectRegion (dpy, cw->borderClip, cw->borderClip, cw->borderSize);
-            XFixesSetPictureClipRegion (dpy, paint_buffer,
-                                        0, 0, cw->borderClip);
-            paint_win (cw, paint_region, paint_buffer, FALSE);
+            XIntersectRegion (cw->borderClip, cw->borderSize, cw->borderClip);
+            if (!XEmptyRegion (cw->borderClip))
+            {
+                XRenderSetPictureClipRegion (dpy, paint_buffer, cw->borderClip);
+                paint_win (cw, paint_region, paint_buffer, FALSE);
+            }
         }
 
         if (shadowClip)
         {
-            XFixesDestroyRegion (dpy, shadowClip);
+            XDestroyRegion (shadowClip);
         }
 
         if (cw->borderClip)
         {
-            XFixesDestroyRegion (dpy, cw->borderClip);
-            cw->borderClip = None;
+            XDestroyRegion (cw->borderClip);
+            cw->borderClip = NULL;
         }
     }
 
     TRACE ("Copying data back to screen");
     /* Set clipping back to the given region */
-    XFixesSetPictureClipRegion (dpy, screen_info->rootBuffer[buffer],
-                                0, 0, region);
+    XRenderSetPictureClipRegion (dpy, screen_info->rootBuffer[buffer], region);
     if (screen_info->use_glx)
     {
         if (screen_info->zoomed)
@@ -2181,6 +2574,8 @@ paint_all (ScreenInfo *screen_info, XserverRegion region, gushort buffer)
                               None, screen_info->rootBuffer[buffer],
                               0, 0, 0, 0, 0, 0, screen_width, screen_height);
         }
+
+        /* The final clip is the only region the server needs to know about */
         present_flip (screen_info, region, screen_info->rootPixmap[buffer]);
         screen_info->present_pending = TRUE;
         DBG ("present flip requested, present pending...");
@@ -2204,7 +2599,8 @@ paint_all (ScreenInfo *screen_info, XserverRegion region, gushort buffer)
         XFlush (dpy);
     }
 
-    XFixesDestroyRegion (dpy, paint_region);
+    XDestroyRegion (paint_region);
+    update_stats (screen_info, paint_start, paint_request, painted, skipped, damage_area);
 }
 
 static void
@@ -2219,6 +2615,14 @@ remove_timeouts (ScreenInfo *screen_info)
 #endif /* TIMEOUT_REPAINT */
 }
 
+static void
+frame_painted (ScreenInfo *screen_info)
+{
+    /* Remember which frame was painted so it does not get painted twice */
+    screen_info->painted_frame_time = MAX (screen_info->next_frame_time,
+                                           g_get_monotonic_time ());
+}
+
 static gboolean
 repair_screen (ScreenInfo *screen_info)
 {
@@ -2240,19 +2644,19 @@ repair_screen (ScreenInfo *screen_info)
         {
             if (!screen_info->present_pending)
             {
-                XserverRegion damage = screen_info->allDamage;
+                Region damage = screen_info->allDamage;
 
                 if (screen_info->prevDamage)
                 {
-                    XFixesUnionRegion(display_info->dpy,
-                                      screen_info->prevDamage,
-                                      screen_info->prevDamage,
-                                      damage);
+                    XUnionRegion (screen_info->prevDamage,
+                                  damage,
+                                  screen_info->prevDamage);
                     damage = screen_info->prevDamage;
                 }
 
                 remove_timeouts (screen_info);
                 paint_all (screen_info, damage, screen_info->current_buffer);
+                frame_painted (screen_info);
 
                 if (++screen_info->current_buffer > 1)
                 {
@@ -2261,11 +2665,11 @@ repair_screen (ScreenInfo *screen_info)
 
                 if (screen_info->prevDamage)
                 {
-                    XFixesDestroyRegion (display_info->dpy, screen_info->prevDamage);
+                    XDestroyRegion (screen_info->prevDamage);
                 }
 
                 screen_info->prevDamage = screen_info->allDamage;
-                screen_info->allDamage = None;
+                screen_info->allDamage = NULL;
 
                 return FALSE;
             }
@@ -2280,8 +2684,9 @@ repair_screen (ScreenInfo *screen_info)
         {
             remove_timeouts (screen_info);
             paint_all (screen_info, screen_info->allDamage, screen_info->current_buffer);
-            XFixesDestroyRegion (display_info->dpy, screen_info->allDamage);
-            screen_info->allDamage = None;
+            frame_painted (screen_info);
+            XDestroyRegion (screen_info->allDamage);
+            screen_info->allDamage = NULL;
         }
     }
 
@@ -2289,6 +2694,49 @@ repair_screen (ScreenInfo *screen_info)
 }
 
 #if TIMEOUT_REPAINT
+/*
+ * Damage is accumulated until just before the next predicted vblank, then
+ * painted at once. A frame that was already painted is never painted again,
+ * so damage storms cost at most one repaint per refresh. Without any vblank
+ * timing there is nothing to align to, isolated damage is painted right away
+ * and only storms are held back to one repaint per frame interval.
+ */
+static guint
+get_repaint_delay (ScreenInfo *screen_info)
+{
+    gint64 now, interval, phase, next;
+
+    now = g_get_monotonic_time ();
+    interval = screen_info->frame_interval;
+    phase = screen_info->last_vblank_time;
+    if (phase == 0)
+    {
+        next = MAX (now, screen_info->painted_frame_time + interval);
+        screen_info->next_frame_time = next;
+
+        return (guint) ((next - now) / 1000);
+    }
+
+    next = now + FRAME_PAINT_BUDGET;
+    if (next > phase)
+    {
+        next = phase + ((next - phase + interval - 1) / interval) * interval;
+    }
+    else
+    {
+        next = phase;
+    }
+    if (next <= screen_info->painted_frame_time)
+    {
+        next = screen_info->painted_frame_time + interval;
+    }
+    screen_info->next_frame_time = next;
+
+    return (guint) (MAX (next - FRAME_PAINT_BUDGET - now, 0) / 1000);
+}
+
+static void add_repair (ScreenInfo *screen_info);
+
 static gboolean
 compositor_timeout_cb (gpointer data)
 {
@@ -2296,7 +2744,13 @@ compositor_timeout_cb (gpointer data)
 
     screen_info = (ScreenInfo *) data;
     screen_info->compositor_timeout_id = 0;
-    return repair_screen (screen_info);
+    if (repair_screen (screen_info))
+    {
+        /* Still waiting for the previous frame, try again on the next one */
+        add_repair (screen_info);
+    }
+
+    return FALSE;
 }
 #endif /* TIMEOUT_REPAINT */
 
@@ -2307,7 +2761,7 @@ add_repair (ScreenInfo *screen_info)
     if (screen_info->compositor_timeout_id == 0)
     {
         screen_info->compositor_timeout_id =
-            g_timeout_add (TIMEOUT_REPAINT,
+            g_timeout_add (get_repaint_delay (screen_info),
                            compositor_timeout_cb, screen_info);
     }
 #endif /* TIMEOUT_REPAINT */
@@ -2330,25 +2784,21 @@ repair_display (DisplayInfo *display_info)
 #endif /* TIMEOUT_REPAINT == 0 */
 
 static void
-add_damage (ScreenInfo *screen_info, XserverRegion damage)
+add_damage (ScreenInfo *screen_info, Region damage)
 {
-    DisplayInfo *display_info;
-
     TRACE ("entering add_damage");
 
-    if (damage == None)
+    if (damage == NULL)
     {
         return;
     }
 
-    display_info = screen_info->display_info;
-    if (screen_info->allDamage != None)
+    if (screen_info->allDamage != NULL)
     {
-        XFixesUnionRegion (display_info->dpy,
-                           screen_info->allDamage,
-                           screen_info->allDamage,
-                           damage);
-        XFixesDestroyRegion (display_info->dpy, damage);
+        XUnionRegion (screen_info->allDamage,
+                      damage,
+                      screen_info->allDamage);
+        XDestroyRegion (damage);
     }
     else
     {
@@ -2360,14 +2810,12 @@ add_damage (ScreenInfo *screen_info, XserverRegion damage)
 }
 
 static void
-fix_region (CWindow *cw, XserverRegion region)
+fix_region (CWindow *cw, Region region)
 {
     GList *list;
     ScreenInfo *screen_info;
-    DisplayInfo *display_info;
 
     screen_info = cw->screen_info;
-    display_info = screen_info->display_info;
 
     /* Exclude opaque windows in front of the given area */
     for (list = screen_info->cwindows; list; list = g_list_next (list))
@@ -2386,24 +2834,27 @@ fix_region (CWindow *cw, XserverRegion region)
             {
                 cw2->picture = get_window_picture (cw2);
             }
-            if (cw2->borderSize == None)
+            if (cw2->borderSize == NULL)
             {
                 cw2->borderSize = border_size (cw2);
             }
-            if (cw2->clientSize == None)
+            if (cw2->clientSize == NULL)
             {
                 cw2->clientSize = client_size (cw2);
             }
             /* ...before subtracting them from the damaged zone. */
             if ((cw2->clientSize) && (screen_info->params->frame_opacity < 100))
             {
-                XFixesSubtractRegion (display_info->dpy, region,
-                                     region, cw2->clientSize);
+                XSubtractRegion (region, cw2->clientSize, region);
             }
             else if (cw2->borderSize)
             {
-                XFixesSubtractRegion (display_info->dpy, region,
-                                     region, cw2->borderSize);
+                XSubtractRegion (region, cw2->borderSize, region);
+            }
+            /* Nothing left to exclude from */
+            if (XEmptyRegion (region))
+            {
+                break;
             }
         }
     }
@@ -2414,7 +2865,8 @@ repair_win (CWindow *cw, XRectangle *r)
 {
     DisplayInfo *display_info;
     ScreenInfo *screen_info;
-    XserverRegion parts;
+    Region parts;
+    XRectangle area;
 
     g_return_if_fail (cw != NULL);
 
@@ -2428,52 +2880,61 @@ repair_win (CWindow *cw, XRectangle *r)
         return;
     }
 
+    /*
+     * The damage object only reports when it becomes non empty, once per
+     * repair cycle, and the area it carries is the whole window. Fetching
+     * the exact damaged region would cost a round trip, so the window is
+     * repainted as a whole instead.
+     */
     if (cw->damaged)
     {
-        parts = XFixesCreateRegion (display_info->dpy, NULL, 0);
-        /* Copy the damage region to parts, subtracting it from the window's damage */
-        XDamageSubtract (display_info->dpy, cw->damage, None, parts);
-        XFixesTranslateRegion (display_info->dpy, parts,
-                               cw->attr.x + cw->attr.border_width,
-                               cw->attr.y + cw->attr.border_width);
+        area = *r;
+        area.x += cw->attr.x + cw->attr.border_width;
+        area.y += cw->attr.y + cw->attr.border_width;
+        parts = region_create_from_rect (&area);
     }
     else
     {
         parts = win_extents (cw);
-        /* Subtract all damage from the window's damage */
-        XDamageSubtract (display_info->dpy, cw->damage, None, None);
     }
+    /* Subtract all damage from the window's damage */
+    XDamageSubtract (display_info->dpy, cw->damage, None, None);
 
     if (parts)
     {
         fix_region (cw, parts);
         /* parts region will be destroyed by add_damage () */
         add_damage (cw->screen_info, parts);
-        cw->damaged = TRUE;
+        if (!cw->damaged)
+        {
+            /* Only painted from now on */
+            screen_info->clipChanged = TRUE;
+            cw->damaged = TRUE;
+        }
     }
 }
 
 static void
 damage_screen (ScreenInfo *screen_info)
 {
-    DisplayInfo *display_info;
-    XserverRegion region;
+    Region region;
     XRectangle  r;
 
-    display_info = screen_info->display_info;
     r.x = 0;
     r.y = 0;
     r.width = screen_info->width;
     r.height = screen_info->height;
-    region = XFixesCreateRegion (display_info->dpy, &r, 1);
+    region = region_create_from_rect (&r);
     /* region will be freed by add_damage () */
     add_damage (screen_info, region);
+    /* Whatever changed for the whole screen likely changed the clip as well */
+    screen_info->clipChanged = TRUE;
 }
 
 static void
 damage_win (CWindow *cw)
 {
-    XserverRegion extents;
+    Region extents;
 
     g_return_if_fail (cw != NULL);
     TRACE ("entering damage_win");
@@ -2503,9 +2964,10 @@ update_extents (CWindow *cw)
 
     if (cw->extents)
     {
-        XFixesDestroyRegion (display_info->dpy, cw->extents);
-        cw->extents = None;
+        XDestroyRegion (cw->extents);
+        cw->extents = NULL;
     }
+    screen_info->clipChanged = TRUE;
 }
 
 static void
@@ -2531,67 +2993,228 @@ determine_mode (CWindow *cw)
         cw->shadowPict = None;
     }
 
-    if (cw->alphaBorderPict)
+    if (cw->alphaBorderPict)
+    {
+        XRenderFreePicture (display_info->dpy, cw->alphaBorderPict);
+        cw->alphaBorderPict = None;
+    }
+
+    format = XRenderFindVisualFormat (display_info->dpy, cw->attr.visual);
+    cw->argb = ((format) && (format->type == PictTypeDirect) && (format->direct.alphaMask));
+    screen_info->clipChanged = TRUE;
+
+    if (cw->extents)
+    {
+        Region damage;
+
+        damage = region_copy (cw->extents);
+        fix_region (cw, damage);
+        /* damage region will be destroyed by add_damage () */
+        add_damage (screen_info, damage);
+    }
+}
+
+static void
+expose_area (ScreenInfo *screen_info, XRectangle *rects, gint nrects)
+{
+    Region region;
+    gint i;
+
+    g_return_if_fail (rects != NULL);
+    g_return_if_fail (nrects > 0);
+    TRACE ("entering expose_area");
+
+    region = XCreateRegion ();
+    for (i = 0; i < nrects; i++)
+    {
+        XUnionRectWithRegion (&rects[i], region, region);
+    }
+    /* region will be destroyed by add_damage () */
+    add_damage (screen_info, region);
+}
+
+static void check_unredirect (ScreenInfo *screen_info);
+
+static void
+set_win_opacity (CWindow *cw, guint32 opacity)
+{
+    DisplayInfo *display_info;
+    ScreenInfo *screen_info;
+
+    g_return_if_fail (cw != NULL);
+    TRACE ("entering set_win_opacity");
+
+    screen_info = cw->screen_info;
+    display_info = screen_info->display_info;
+
+    cw->opacity = opacity;
+    /* determine_mode () flags the clip as changed */
+    determine_mode(cw);
+    if (cw->shadow)
+    {
+        XRenderFreePicture (display_info->dpy, cw->shadow);
+        cw->shadow = None;
+        if (cw->extents)
+        {
+            XDestroyRegion (cw->extents);
+        }
+        cw->extents = win_extents (cw);
+        add_repair (screen_info);
+    }
+    check_unredirect (screen_info);
+}
+
+/*
+ * The overlay is screen wide, so compositing can only be bypassed for a
+ * window covering the whole screen, that nothing still composited sits on.
+ */
+static CWindow *
+get_unredirect_candidate (ScreenInfo *screen_info)
+{
+    GList *list;
+    CWindow *cw;
+
+    if (!screen_info->params->unredirect_fullscreen)
+    {
+        return NULL;
+    }
+
+    for (list = screen_info->cwindows; list; list = g_list_next (list))
+    {
+        cw = (CWindow *) list->data;
+        if (!WIN_IS_VIEWABLE(cw) || (cw->attr.class == InputOnly))
+        {
+            continue;
+        }
+        if (!WIN_IS_REDIRECTED(cw) && (cw->id != screen_info->unredirected_fullscreen))
+        {
+            /* Already displayed directly, such as fullscreen overlays */
+            continue;
+        }
+        if (WIN_IS_FULLSCREEN(cw) && WIN_IS_OPAQUE(cw) && !WIN_IS_SHAPED(cw) &&
+            !(WIN_HAS_CLIENT(cw) && (cw->c->type & WINDOW_DESKTOP)))
+        {
+            return cw;
+        }
+        /* Anything else on top, translucent popups included, needs compositing */
+        return NULL;
+    }
+
+    return NULL;
+}
+
+static void
+stop_unredirect (ScreenInfo *screen_info)
+{
+    DisplayInfo *display_info;
+    CWindow *cw;
+
+    TRACE ("entering stop_unredirect");
+
+    display_info = screen_info->display_info;
+    cw = find_cwindow_in_screen (screen_info, screen_info->unredirected_fullscreen);
+    screen_info->unredirected_fullscreen = None;
+    if ((cw == NULL) || WIN_IS_REDIRECTED(cw))
+    {
+        return;
+    }
+
+    TRACE ("Redirecting fullscreen window 0x%lx", cw->id);
+    /* The window may be on its way out already */
+    gdk_error_trap_push ();
+    XCompositeRedirectWindow (display_info->dpy, cw->id, display_info->composite_mode);
+    gdk_error_trap_pop ();
+
+    cw->redirected = TRUE;
+    screen_info->clipChanged = TRUE;
+    if (cw->fulloverlay)
     {
-        XRenderFreePicture (display_info->dpy, cw->alphaBorderPict);
-        cw->alphaBorderPict = None;
+        cw->fulloverlay = FALSE;
+        screen_info->wins_unredirected--;
+    }
+#if HAVE_OVERLAYS
+    if ((screen_info->wins_unredirected == 0) && (display_info->have_overlays))
+    {
+        TRACE ("Remapping overlay window");
+        XMapWindow (display_info->dpy, screen_info->overlay);
     }
+#endif /* HAVE_OVERLAYS */
+    damage_screen (screen_info);
+}
 
-    format = XRenderFindVisualFormat (display_info->dpy, cw->attr.visual);
-    cw->argb = ((format) && (format->type == PictTypeDirect) && (format->direct.alphaMask));
+static void
+start_unredirect (ScreenInfo *screen_info, CWindow *cw)
+{
+    TRACE ("Unredirecting fullscreen window 0x%lx", cw->id);
 
-    if (cw->extents)
+    unredirect_win (cw);
+    screen_info->unredirected_fullscreen = cw->id;
+    cw->fulloverlay = TRUE;
+    screen_info->wins_unredirected++;
+#if HAVE_OVERLAYS
+    if ((screen_info->wins_unredirected == 1) && (screen_info->display_info->have_overlays))
     {
-        XserverRegion damage;
-
-        damage = XFixesCreateRegion (display_info->dpy, NULL, 0);
-        XFixesCopyRegion (display_info->dpy, damage, cw->extents);
-        fix_region (cw, damage);
-        /* damage region will be destroyed by add_damage () */
-        add_damage (screen_info, damage);
+        TRACE ("Unmapping overlay window");
+        XUnmapWindow (myScreenGetXDisplay (screen_info), screen_info->overlay);
     }
+#endif /* HAVE_OVERLAYS */
 }
 
-static void
-expose_area (ScreenInfo *screen_info, XRectangle *rects, gint nrects)
+static gboolean
+unredirect_timeout_cb (gpointer data)
 {
-    DisplayInfo *display_info;
-    XserverRegion region;
+    ScreenInfo *screen_info;
+    CWindow *cw;
 
-    g_return_if_fail (rects != NULL);
-    g_return_if_fail (nrects > 0);
-    TRACE ("entering expose_area");
+    screen_info = (ScreenInfo *) data;
+    screen_info->unredirect_timeout_id = 0;
 
-    display_info = screen_info->display_info;
-    region = XFixesCreateRegion (display_info->dpy, rects, nrects);
-    /* region will be destroyed by add_damage () */
-    add_damage (screen_info, region);
+    cw = get_unredirect_candidate (screen_info);
+    if ((cw) && (screen_info->unredirected_fullscreen == None))
+    {
+        start_unredirect (screen_info, cw);
+    }
+
+    return FALSE;
 }
 
+/*
+ * Redirecting back is immediate so that nothing ever shows up hidden behind
+ * the window, but a candidate has to remain so for UNREDIRECT_DELAY before
+ * compositing is bypassed, so short lived popups do not cause any flicker.
+ */
 static void
-set_win_opacity (CWindow *cw, guint32 opacity)
+check_unredirect (ScreenInfo *screen_info)
 {
-    DisplayInfo *display_info;
-    ScreenInfo *screen_info;
+    CWindow *cw;
 
-    g_return_if_fail (cw != NULL);
-    TRACE ("entering set_win_opacity");
+    if (!screen_info->compositor_active)
+    {
+        return;
+    }
 
-    screen_info = cw->screen_info;
-    display_info = screen_info->display_info;
+    cw = get_unredirect_candidate (screen_info);
+    if (screen_info->unredirected_fullscreen != None)
+    {
+        if ((cw) && (cw->id == screen_info->unredirected_fullscreen))
+        {
+            return;
+        }
+        stop_unredirect (screen_info);
+    }
 
-    cw->opacity = opacity;
-    determine_mode(cw);
-    if (cw->shadow)
+    if (cw == NULL)
     {
-        XRenderFreePicture (display_info->dpy, cw->shadow);
-        cw->shadow = None;
-        if (cw->extents)
+        if (screen_info->unredirect_timeout_id != 0)
         {
-            XFixesDestroyRegion (display_info->dpy, cw->extents);
+            g_source_remove (screen_info->unredirect_timeout_id);
+            screen_info->unredirect_timeout_id = 0;
         }
-        cw->extents = win_extents (cw);
-        add_repair (screen_info);
+    }
+    else if (screen_info->unredirect_timeout_id == 0)
+    {
+        screen_info->unredirect_timeout_id =
+            g_timeout_add (UNREDIRECT_DELAY, unredirect_timeout_cb, screen_info);
     }
 }
 
@@ -2629,11 +3252,13 @@ map_win (CWindow *cw)
             XUnmapWindow (myScreenGetXDisplay (screen_info), screen_info->overlay);
         }
 #endif /* HAVE_OVERLAYS */
+        check_unredirect (screen_info);
         return;
     }
 
     cw->viewable = TRUE;
     cw->damaged = FALSE;
+    screen_info->clipChanged = TRUE;
 
     /* Check for new windows to un-redirect. */
     if (WIN_HAS_DAMAGE(cw) && WIN_IS_OVERRIDE(cw) &&
@@ -2648,6 +3273,8 @@ map_win (CWindow *cw)
             unredirect_win (cw);
         }
     }
+
+    check_unredirect (screen_info);
 }
 
 static void
@@ -2662,6 +3289,11 @@ unmap_win (CWindow *cw)
     screen_info = cw->screen_info;
     display_info = screen_info->display_info;
 
+    if (cw->id == screen_info->unredirected_fullscreen)
+    {
+        stop_unredirect (screen_info);
+    }
+
     if (!WIN_IS_REDIRECTED(cw) && (screen_info->wins_unredirected > 0))
     {
         if (cw->fulloverlay)
@@ -2694,6 +3326,7 @@ unmap_win (CWindow *cw)
     cw->fulloverlay = FALSE;
 
     free_win_data (cw, FALSE);
+    check_unredirect (screen_info);
 }
 
 static void
@@ -2823,21 +3456,25 @@ add_win (DisplayInfo *display_info, Window id, Client *c)
     new->alphaPict = None;
     new->alphaBorderPict = None;
     new->shadowPict = None;
-    new->borderSize = None;
-    new->clientSize = None;
-    new->extents = None;
+    new->shape = NULL;
+    new->borderSize = NULL;
+    new->clientSize = NULL;
+    new->extents = NULL;
+    new->visible = NULL;
     new->shadow = None;
     new->shadow_dx = 0;
     new->shadow_dy = 0;
     new->shadow_width = 0;
     new->shadow_height = 0;
-    new->borderClip = None;
+    new->borderClip = NULL;
 
     init_opacity (new);
     determine_mode (new);
 
     /* Insert window at top of stack */
     screen_info->cwindows = g_list_prepend (screen_info->cwindows, new);
+    screen_info->clipChanged = TRUE;
+    g_hash_table_insert (display_info->cwindow_hash, GUINT_TO_POINTER (id), new);
 
     if (WIN_IS_VISIBLE(new))
     {
@@ -2899,14 +3536,18 @@ restack_win (CWindow *cw, Window above)
             screen_info->cwindows = g_list_insert_before (screen_info->cwindows, list, cw);
         }
     }
+    screen_info->clipChanged = TRUE;
+    check_unredirect (screen_info);
 }
 
+static void invalidate_thumbnail (CWindow *cw);
+
 static void
 resize_win (CWindow *cw, gint x, gint y, gint width, gint height, gint bw)
 {
     DisplayInfo *display_info;
     ScreenInfo *screen_info;
-    XserverRegion damage;
+    Region damage;
 
     g_return_if_fail (cw != NULL);
     TRACE ("entering resize_win");
@@ -2914,25 +3555,23 @@ resize_win (CWindow *cw, gint x, gint y, gint width, gint height, gint bw)
 
     screen_info = cw->screen_info;
     display_info = screen_info->display_info;
-    damage = None;
+    damage = NULL;
 
     if (WIN_IS_VISIBLE(cw))
     {
-        damage = XFixesCreateRegion (display_info->dpy, NULL, 0);
-        if (cw->extents)
-        {
-            XFixesCopyRegion (display_info->dpy, damage, cw->extents);
-        }
+        damage = region_copy (cw->extents);
     }
 
     if (cw->extents)
     {
-        XFixesDestroyRegion (display_info->dpy, cw->extents);
-        cw->extents = None;
+        XDestroyRegion (cw->extents);
+        cw->extents = NULL;
     }
+    screen_info->clipChanged = TRUE;
 
     if ((cw->attr.width != width) || (cw->attr.height != height))
     {
+        invalidate_thumbnail (cw);
 #if HAVE_NAME_WINDOW_PIXMAP
         if (cw->name_window_pixmap)
         {
@@ -2957,6 +3596,12 @@ resize_win (CWindow *cw, gint x, gint y, gint width, gint height, gint bw)
             XRenderFreePicture (display_info->dpy, cw->shadow);
             cw->shadow = None;
         }
+
+        if (cw->shape)
+        {
+            XDestroyRegion (cw->shape);
+            cw->shape = NULL;
+        }
     }
 
     if ((cw->attr.width != width) || (cw->attr.height != height) ||
@@ -2964,14 +3609,14 @@ resize_win (CWindow *cw, gint x, gint y, gint width, gint height, gint bw)
     {
         if (cw->borderSize)
         {
-            XFixesDestroyRegion (display_info->dpy, cw->borderSize);
-            cw->borderSize = None;
+            XDestroyRegion (cw->borderSize);
+            cw->borderSize = NULL;
         }
 
         if (cw->clientSize)
         {
-            XFixesDestroyRegion (display_info->dpy, cw->clientSize);
-            cw->clientSize = None;
+            XDestroyRegion (cw->clientSize);
+            cw->clientSize = NULL;
         }
     }
 
@@ -2984,12 +3629,13 @@ resize_win (CWindow *cw, gint x, gint y, gint width, gint height, gint bw)
     if (damage)
     {
         cw->extents = win_extents (cw);
-        XFixesUnionRegion (display_info->dpy, damage, damage, cw->extents);
+        XUnionRegion (damage, cw->extents, damage);
 
         fix_region (cw, damage);
         /* damage region will be destroyed by add_damage () */
         add_damage (screen_info, damage);
     }
+    check_unredirect (screen_info);
 }
 
 static void
@@ -2997,7 +3643,7 @@ reshape_win (CWindow *cw)
 {
     DisplayInfo *display_info;
     ScreenInfo *screen_info;
-    XserverRegion damage;
+    Region damage;
 
     g_return_if_fail (cw != NULL);
     TRACE ("entering reshape_win");
@@ -3005,22 +3651,19 @@ reshape_win (CWindow *cw)
     screen_info = cw->screen_info;
     display_info = screen_info->display_info;
 
-    damage = None;
+    damage = NULL;
 
     if (WIN_IS_VISIBLE(cw))
     {
-        damage = XFixesCreateRegion (display_info->dpy, NULL, 0);
-        if (cw->extents)
-        {
-            XFixesCopyRegion (display_info->dpy, damage, cw->extents);
-        }
+        damage = region_copy (cw->extents);
     }
 
     if (cw->extents)
     {
-        XFixesDestroyRegion (display_info->dpy, cw->extents);
-        cw->extents = None;
+        XDestroyRegion (cw->extents);
+        cw->extents = NULL;
     }
+    screen_info->clipChanged = TRUE;
 
     if (cw->shadow)
     {
@@ -3028,26 +3671,32 @@ reshape_win (CWindow *cw)
         cw->shadow = None;
     }
 
+    if (cw->shape)
+    {
+        XDestroyRegion (cw->shape);
+        cw->shape = NULL;
+    }
+
     if (cw->borderSize)
     {
-        XFixesDestroyRegion (display_info->dpy, cw->borderSize);
-        cw->borderSize = None;
+        XDestroyRegion (cw->borderSize);
+        cw->borderSize = NULL;
     }
 
     if (cw->clientSize)
     {
-        XFixesDestroyRegion (display_info->dpy, cw->clientSize);
-        cw->clientSize = None;
+        XDestroyRegion (cw->clientSize);
+        cw->clientSize = NULL;
     }
 
     if (damage)
     {
         cw->extents = win_extents (cw);
-        XFixesUnionRegion (display_info->dpy, damage, damage, cw->extents);
+        XUnionRegion (damage, cw->extents, damage);
 
         /* A shape notify will likely change the shadows too, so clear the extents */
-        XFixesDestroyRegion (display_info->dpy, cw->extents);
-        cw->extents = None;
+        XDestroyRegion (cw->extents);
+        cw->extents = NULL;
 
         fix_region (cw, damage);
         /* damage region will be destroyed by add_damage () */
@@ -3075,6 +3724,8 @@ destroy_win (DisplayInfo *display_info, Window id)
         }
         screen_info = cw->screen_info;
         screen_info->cwindows = g_list_remove (screen_info->cwindows, (gconstpointer) cw);
+        screen_info->clipChanged = TRUE;
+        g_hash_table_remove (display_info->cwindow_hash, GUINT_TO_POINTER (cw->id));
 
         free_win_data (cw, TRUE);
     }
@@ -3217,6 +3868,11 @@ compositorHandleDamage (DisplayInfo *display_info, XDamageNotifyEvent *ev)
      */
 
     cw = find_cwindow_in_display (display_info, ev->drawable);
+    if (cw)
+    {
+        invalidate_thumbnail (cw);
+    }
+
     if ((cw) && WIN_IS_REDIRECTED(cw))
     {
         screen_info = cw->screen_info;
@@ -3513,6 +4169,8 @@ compositorHandleShapeNotify (DisplayInfo *display_info, XShapeEvent *ev)
             {
                 cw->shaped = TRUE;
             }
+            /* Only once the shape flag is current, it decides unredirection */
+            check_unredirect (cw->screen_info);
         }
     }
 }
@@ -3578,6 +4236,7 @@ compositorHandlePresentCompleteNotify (DisplayInfo *display_info, XPresentComple
         {
              DBG ("present completed, present pending cleared");
              screen_info->present_pending = FALSE;
+             update_frame_timing (screen_info, ev->ust, ev->msc);
              break;
         }
     }
@@ -3746,6 +4405,137 @@ compositorScaleWindowPixmap (CWindow *cw, guint *width, guint *height)
     return dstPixmap;
 }
 
+/*
+ * Scaling the window content is not free, so the tabwin previews are kept
+ * per window, server side, and only rebuilt once the window was damaged.
+ * The returned picture belongs to the window.
+ */
+static Picture
+get_window_thumbnail (CWindow *cw, guint width, guint height)
+{
+    ScreenInfo *screen_info;
+    Display *dpy;
+    XRenderPictFormat *render_format;
+    Picture thumbnail;
+    Pixmap pixmap;
+    guint w, h;
+
+    screen_info = cw->screen_info;
+    dpy = myScreenGetXDisplay (screen_info);
+
+    if ((cw->thumbnail) && !(cw->thumbnail_stale) &&
+        (cw->thumbnail_width == width) && (cw->thumbnail_height == height))
+    {
+        return cw->thumbnail;
+    }
+
+    w = width;
+    h = height;
+    pixmap = compositorScaleWindowPixmap (cw, &w, &h);
+    if (pixmap == None)
+    {
+        return None;
+    }
+
+    render_format = XRenderFindStandardFormat (dpy, PictStandardARGB32);
+    thumbnail = XRenderCreatePicture (dpy, pixmap, render_format, 0, NULL);
+    XFreePixmap (dpy, pixmap);
+    if (thumbnail == None)
+    {
+        return None;
+    }
+
+    if (cw->thumbnail)
+    {
+        XRenderFreePicture (dpy, cw->thumbnail);
+    }
+    cw->thumbnail = thumbnail;
+    cw->thumbnail_width = width;
+    cw->thumbnail_height = height;
+    cw->thumbnail_scaled_width = w;
+    cw->thumbnail_scaled_height = h;
+    cw->thumbnail_stale = FALSE;
+
+    return thumbnail;
+}
+
+static gboolean
+thumbnail_refresh_enabled (ScreenInfo *screen_info)
+{
+    return (screen_info->compositor_active &&
+            screen_info->params->cycle_preview &&
+            screen_info->params->cycle_preview_refresh);
+}
+
+static gboolean
+thumbnail_timeout_cb (gpointer data)
+{
+    ScreenInfo *screen_info;
+    GList *list;
+    guint refreshed;
+
+    screen_info = (ScreenInfo *) data;
+
+    if (!thumbnail_refresh_enabled (screen_info))
+    {
+        screen_info->thumbnail_timeout_id = 0;
+        return FALSE;
+    }
+
+    refreshed = 0;
+    for (list = screen_info->cwindows; list; list = g_list_next (list))
+    {
+        CWindow *cw = (CWindow *) list->data;
+
+        if (!(cw->thumbnail) || !(cw->thumbnail_stale))
+        {
+            continue;
+        }
+
+        if (refreshed == THUMBNAIL_REFRESH_BATCH)
+        {
+            /* Leave the rest for the next run */
+            return TRUE;
+        }
+
+        if (get_window_thumbnail (cw, cw->thumbnail_width, cw->thumbnail_height) == None)
+        {
+            /* Nothing to scale from, do not try again until damaged */
+            XRenderFreePicture (myScreenGetXDisplay (screen_info), cw->thumbnail);
+            cw->thumbnail = None;
+        }
+        refreshed++;
+    }
+
+    screen_info->thumbnail_timeout_id = 0;
+    return FALSE;
+}
+
+/*
+ * Only windows which already had a thumbnail, i.e. which have been shown in
+ * the tabwin before, are refreshed, and at low priority so that it never
+ * delays the repaint.
+ */
+static void
+invalidate_thumbnail (CWindow *cw)
+{
+    ScreenInfo *screen_info;
+
+    if (!(cw->thumbnail) || (cw->thumbnail_stale))
+    {
+        return;
+    }
+    cw->thumbnail_stale = TRUE;
+
+    screen_info = cw->screen_info;
+    if ((screen_info->thumbnail_timeout_id == 0) && thumbnail_refresh_enabled (screen_info))
+    {
+        screen_info->thumbnail_timeout_id =
+            g_timeout_add_full (G_PRIORITY_LOW, THUMBNAIL_REFRESH_DELAY,
+                                thumbnail_timeout_cb, screen_info, NULL);
+    }
+}
+
 #endif /* HAVE_COMPOSITOR */
 
 gboolean
@@ -3925,6 +4715,77 @@ compositorGetWindowPixmapAtSize (ScreenInfo *screen_info, Window id, guint *widt
     return None;
 }
 
+/* Paints a thumbnail of the window content centered in the given box of
+ * the drawable, entirely server side. The thumbnail is served from the
+ * cache unless the window was damaged since. Returns FALSE when the
+ * compositor cannot provide one (same cases as above).
+ */
+gboolean
+compositorPaintWindowThumbnail (ScreenInfo *screen_info, Window id, Drawable drawable, Visual *visual,
+                                gint x, gint y, guint width, guint height, gboolean iconified)
+{
+#ifdef HAVE_NAME_WINDOW_PIXMAP
+#ifdef HAVE_COMPOSITOR
+    CWindow *cw;
+    Display *dpy;
+    XRenderPictFormat *render_format;
+    Picture thumbnail, destPicture, maskPicture;
+
+    g_return_val_if_fail (id != None, FALSE);
+    g_return_val_if_fail (drawable != None, FALSE);
+
+    TRACE ("entering compositorPaintWindowThumbnail: 0x%lx", id);
+
+    if (!compositorIsActive (screen_info))
+    {
+        return FALSE;
+    }
+
+    cw = find_cwindow_in_screen (screen_info, id);
+    if (!cw)
+    {
+        return FALSE;
+    }
+
+    thumbnail = get_window_thumbnail (cw, width, height);
+    if (!thumbnail)
+    {
+        return FALSE;
+    }
+
+    dpy = myScreenGetXDisplay (screen_info);
+    render_format = XRenderFindVisualFormat (dpy, visual);
+    if (!render_format)
+    {
+        return FALSE;
+    }
+
+    destPicture = XRenderCreatePicture (dpy, drawable, render_format, 0, NULL);
+    maskPicture = None;
+    if (iconified)
+    {
+        maskPicture = solid_picture (screen_info, FALSE, THUMBNAIL_ICONIFIED_ALPHA, 0.0, 0.0, 0.0);
+    }
+
+    XRenderComposite (dpy, PictOpOver, thumbnail, maskPicture, destPicture,
+                      0, 0, 0, 0,
+                      x + ((gint) width - (gint) cw->thumbnail_scaled_width) / 2,
+                      y + ((gint) height - (gint) cw->thumbnail_scaled_height) / 2,
+                      cw->thumbnail_scaled_width, cw->thumbnail_scaled_height);
+
+    if (maskPicture)
+    {
+        XRenderFreePicture (dpy, maskPicture);
+    }
+    XRenderFreePicture (dpy, destPicture);
+
+    return TRUE;
+#endif /* HAVE_COMPOSITOR */
+#endif /* HAVE_NAME_WINDOW_PIXMAP */
+
+    return FALSE;
+}
+
 void
 compositorHandleEvent (DisplayInfo *display_info, XEvent *ev)
 {
@@ -4148,6 +5009,7 @@ compositorInitDisplay (DisplayInfo *display_info)
     }
 
     display_info->composite_mode = 0;
+    display_info->cwindow_hash = g_hash_table_new (g_direct_hash, g_direct_equal);
 #if HAVE_NAME_WINDOW_PIXMAP
     display_info->have_name_window_pixmap = ((composite_major > 0) || (composite_minor >= 2));
 #else  /* HAVE_NAME_WINDOW_PIXMAP */
@@ -4271,8 +5133,9 @@ compositorManageScreen (ScreenInfo *screen_info)
     }
 
     screen_info->gaussianSize = -1;
-    screen_info->gaussianMap = make_gaussian_map(SHADOW_RADIUS);
+    screen_info->gaussianMap = gaussianMapNew (SHADOW_RADIUS);
     presum_gaussian (screen_info);
+    screen_info->shadowSlices = g_new0 (Picture, SHADOW_OPACITY_LEVELS * SHADOW_SLICE_COUNT);
     screen_info->cursorPicture = None;
     /* Change following argb values to play with shadow colors */
     screen_info->blackPicture = solid_picture (screen_info,
@@ -4282,14 +5145,25 @@ compositorManageScreen (ScreenInfo *screen_info)
                                                0.0, /* green */
                                                0.0  /* blue  */);
     screen_info->rootTile = None;
-    screen_info->allDamage = None;
-    screen_info->prevDamage = None;
+    screen_info->allDamage = NULL;
+    screen_info->prevDamage = NULL;
     screen_info->cwindows = NULL;
+    screen_info->clipChanged = TRUE;
     screen_info->wins_unredirected = 0;
     screen_info->compositor_timeout_id = 0;
+    screen_info->unredirected_fullscreen = None;
+    screen_info->unredirect_timeout_id = 0;
+    screen_info->thumbnail_timeout_id = 0;
+    screen_info->frame_interval = FRAME_INTERVAL_DEFAULT;
+    screen_info->last_vblank_time = 0;
+    screen_info->next_frame_time = 0;
+    screen_info->painted_frame_time = 0;
+    screen_info->last_ust = 0;
+    screen_info->last_msc = 0;
     screen_info->zoomed = FALSE;
     screen_info->zoom_timeout_id = 0;
     screen_info->damages_pending = FALSE;
+    memset (&screen_info->stats, 0, sizeof (compositor_stats));
     screen_info->current_buffer = 0;
     memset(screen_info->transform.matrix, 0, 9);
     screen_info->transform.matrix[0][0] = 1 << 16;
@@ -4321,6 +5195,7 @@ compositorManageScreen (ScreenInfo *screen_info)
     if (screen_info->use_present)
     {
         screen_info->present_pending = FALSE;
+        screen_info->present_region = XFixesCreateRegion (display_info->dpy, NULL, 0);
         XPresentSelectInput (display_info->dpy,
                              screen_info->output,
                              PresentCompleteNotifyMask);
@@ -4367,11 +5242,23 @@ compositorUnmanageScreen (ScreenInfo *screen_info)
 #if TIMEOUT_REPAINT
     remove_timeouts (screen_info);
 #endif /* TIMEOUT_REPAINT */
+    if (screen_info->unredirect_timeout_id != 0)
+    {
+        g_source_remove (screen_info->unredirect_timeout_id);
+        screen_info->unredirect_timeout_id = 0;
+    }
+    if (screen_info->thumbnail_timeout_id != 0)
+    {
+        g_source_remove (screen_info->thumbnail_timeout_id);
+        screen_info->thumbnail_timeout_id = 0;
+    }
+    screen_info->unredirected_fullscreen = None;
 
     i = 0;
     for (list = screen_info->cwindows; list; list = g_list_next (list))
     {
         CWindow *cw2 = (CWindow *) list->data;
+        g_hash_table_remove (display_info->cwindow_hash, GUINT_TO_POINTER (cw2->id));
         free_win_data (cw2, TRUE);
         i++;
     }
@@ -4390,6 +5277,14 @@ compositorUnmanageScreen (ScreenInfo *screen_info)
     }
 #endif /* HAVE_OVERLAYS */
 
+#ifdef HAVE_PRESENT_EXTENSION
+    if (screen_info->use_present)
+    {
+        XFixesDestroyRegion (display_info->dpy, screen_info->present_region);
+        screen_info->present_region = None;
+    }
+#endif /* HAVE_PRESENT_EXTENSION */
+
 #ifdef HAVE_EPOXY
     if (screen_info->use_glx)
     {
@@ -4425,14 +5320,14 @@ compositorUnmanageScreen (ScreenInfo *screen_info)
 
     if (screen_info->allDamage)
     {
-        XFixesDestroyRegion (display_info->dpy, screen_info->allDamage);
-        screen_info->allDamage = None;
+        XDestroyRegion (screen_info->allDamage);
+        screen_info->allDamage = NULL;
     }
 
     if (screen_info->prevDamage)
     {
-        XFixesDestroyRegion (display_info->dpy, screen_info->prevDamage);
-        screen_info->prevDamage = None;
+        XDestroyRegion (screen_info->prevDamage);
+        screen_info->prevDamage = NULL;
     }
 
     if (screen_info->zoomBuffer)
@@ -4458,6 +5353,8 @@ compositorUnmanageScreen (ScreenInfo *screen_info)
         screen_info->cursorPicture = None;
     }
 
+    free_shadow_slices (screen_info);
+
     if (screen_info->shadowTop)
     {
         g_free (screen_info->shadowTop);
@@ -4561,6 +5458,53 @@ compositorActivateScreen (ScreenInfo *screen_info, gboolean active)
 #endif /* HAVE_COMPOSITOR */
 }
 
+void
+compositorCheckUnredirect (ScreenInfo *screen_info)
+{
+#ifdef HAVE_COMPOSITOR
+    g_return_if_fail (screen_info != NULL);
+    TRACE ("entering compositorCheckUnredirect");
+
+    if (!compositorIsUsable (screen_info->display_info))
+    {
+        return;
+    }
+    check_unredirect (screen_info);
+#endif /* HAVE_COMPOSITOR */
+}
+
+void
+compositorDumpStats (DisplayInfo *display_info)
+{
+#ifdef HAVE_COMPOSITOR
+    ScreenInfo *screen_info;
+    compositor_stats *stats;
+    GSList *list;
+
+    g_return_if_fail (display_info != NULL);
+    TRACE ("entering compositorDumpStats");
+
+    for (list = display_info->screens; list; list = g_slist_next (list))
+    {
+        screen_info = (ScreenInfo *) list->data;
+        if (!screen_info->compositor_active)
+        {
+            continue;
+        }
+        stats = &screen_info->stats;
+        g_message ("Screen %i: %" G_GUINT64_FORMAT " frames, paint time last %" G_GINT64_FORMAT
+                   " usec, max %" G_GINT64_FORMAT " usec, average %" G_GINT64_FORMAT " usec",
+                   screen_info->screen, stats->frames, stats->paint_time, stats->max_paint_time,
+                   stats->frames ? stats->total_paint_time / (gint64) stats->frames : 0);
+        g_message ("Screen %i: last frame painted %u windows, skipped %u, damage area %"
+                   G_GUINT64_FORMAT " pixels, %lu X requests",
+                   screen_info->screen, stats->windows_painted, stats->windows_skipped,
+                   stats->damage_area, stats->requests);
+        publish_stats (screen_info);
+    }
+#endif /* HAVE_COMPOSITOR */
+}
+
 void
 compositorUpdateScreenSize (ScreenInfo *screen_info)
 {
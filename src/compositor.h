@@ -56,6 +56,15 @@ Pixmap                   compositorGetWindowPixmapAtSize        (ScreenInfo *,
                                                                  Window,
                                                                  guint *,
                                                                  guint *);
+gboolean                 compositorPaintWindowThumbnail         (ScreenInfo *,
+                                                                 Window,
+                                                                 Drawable,
+                                                                 Visual *,
+                                                                 gint,
+                                                                 gint,
+                                                                 guint,
+                                                                 guint,
+                                                                 gboolean);
 void                     compositorHandleEvent                  (DisplayInfo *,
                                                                  XEvent *);
 void                     compositorZoomIn                       (ScreenInfo *,
@@ -72,6 +81,8 @@ void                     compositorAddAllWindows                (ScreenInfo *);
 gboolean                 compositorActivateScreen               (ScreenInfo *,
                                                                  gboolean);
 void                     compositorUpdateScreenSize             (ScreenInfo *);
+void                     compositorCheckUnredirect              (ScreenInfo *);
+void                     compositorDumpStats                    (DisplayInfo *);
 
 void                     compositorWindowSetOpacity             (DisplayInfo *,
                                                                  Window,
@@ -57,6 +57,19 @@
 #define CURSOR_MOVE XC_fleur
 #endif
 
+/*
+ * Each window known to the display maps to the list of clients using it
+ * along with the SEARCH_* role(s) the window plays for that client. There
+ * is usually one single entry, except for user time windows which may be
+ * shared by several clients, or be the client window itself.
+ */
+typedef struct _ClientWindowRef ClientWindowRef;
+struct _ClientWindowRef
+{
+    Client *c;
+    unsigned short mode;
+};
+
 static int
 handleXError (Display * dpy, XErrorEvent * err)
 {
@@ -176,6 +189,7 @@ myDisplayInitAtoms (DisplayInfo *display_info)
         "WM_TRANSIENT_FOR",
         "WM_WINDOW_ROLE",
         "XFWM4_COMPOSITING_MANAGER",
+        "XFWM4_COMPOSITOR_STATS",
         "XFWM4_TIMESTAMP_PROP",
         "_XROOTPMAP_ID",
         "_XSETROOT_ID"
@@ -217,6 +231,8 @@ myDisplayInit (GdkDisplay *gdisplay)
     display->session = NULL;
     display->quit = FALSE;
     display->reload = FALSE;
+    display->dump_stats = FALSE;
+    display->pending_props = FALSE;
 
     XSetErrorHandler (handleXError);
 
@@ -249,6 +265,7 @@ myDisplayInit (GdkDisplay *gdisplay)
 
 #ifdef HAVE_XSYNC
     display->have_xsync = FALSE;
+    display->xsync_alarms = g_hash_table_new (g_direct_hash, g_direct_equal);
 
     display->xsync_error_base = 0;
     display->xsync_event_base = 0;
@@ -317,6 +334,16 @@ myDisplayInit (GdkDisplay *gdisplay)
     display->xfilter = NULL;
     display->screens = NULL;
     display->clients = NULL;
+    display->client_windows = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                                     NULL, (GDestroyNotify) g_ptr_array_unref);
+#ifdef HAVE_XCB
+    display->prefetched = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                                 NULL, (GDestroyNotify) g_hash_table_destroy);
+#endif /* HAVE_XCB */
+    display->property_cache = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                                     NULL, (GDestroyNotify) g_hash_table_destroy);
+    display->frame_draw_queue = NULL;
+    display->frame_draw_id = 0;
     display->xgrabcount = 0;
     display->double_click_time = 250;
     display->double_click_distance = 5;
@@ -355,6 +382,37 @@ myDisplayClose (DisplayInfo *display)
     g_slist_free (display->clients);
     display->clients = NULL;
 
+    g_hash_table_destroy (display->client_windows);
+    display->client_windows = NULL;
+
+#ifdef HAVE_XCB
+    g_hash_table_destroy (display->prefetched);
+    display->prefetched = NULL;
+#endif /* HAVE_XCB */
+    g_hash_table_destroy (display->property_cache);
+    display->property_cache = NULL;
+
+    if (display->frame_draw_id)
+    {
+        g_source_remove (display->frame_draw_id);
+        display->frame_draw_id = 0;
+    }
+    g_slist_free (display->frame_draw_queue);
+    display->frame_draw_queue = NULL;
+
+#ifdef HAVE_XSYNC
+    g_hash_table_destroy (display->xsync_alarms);
+    display->xsync_alarms = NULL;
+#endif /* HAVE_XSYNC */
+
+#ifdef HAVE_COMPOSITOR
+    if (display->cwindow_hash)
+    {
+        g_hash_table_destroy (display->cwindow_hash);
+        display->cwindow_hash = NULL;
+    }
+#endif /* HAVE_COMPOSITOR */
+
     g_slist_free (display->screens);
     display->screens = NULL;
 
@@ -500,6 +558,131 @@ myDisplayUngrabServer (DisplayInfo *display)
     DBG ("grabs : %i", display->xgrabcount);
 }
 
+void
+myDisplayAddClientWindow (DisplayInfo *display, Client *c, Window w, unsigned short mode)
+{
+    GPtrArray *refs;
+    ClientWindowRef *ref;
+    guint i;
+
+    g_return_if_fail (c != NULL);
+    g_return_if_fail (display != NULL);
+
+    if (w == None)
+    {
+        return;
+    }
+
+    refs = g_hash_table_lookup (display->client_windows, GUINT_TO_POINTER (w));
+    if (refs == NULL)
+    {
+        refs = g_ptr_array_new_with_free_func (g_free);
+        g_hash_table_insert (display->client_windows, GUINT_TO_POINTER (w), refs);
+    }
+
+    for (i = 0; i < refs->len; i++)
+    {
+        ref = g_ptr_array_index (refs, i);
+        if (ref->c == c)
+        {
+            ref->mode |= mode;
+            return;
+        }
+    }
+
+    ref = g_new0 (ClientWindowRef, 1);
+    ref->c = c;
+    ref->mode = mode;
+    g_ptr_array_add (refs, ref);
+}
+
+void
+myDisplayRemoveClientWindow (DisplayInfo *display, Client *c, Window w, unsigned short mode)
+{
+    GPtrArray *refs;
+    ClientWindowRef *ref;
+    guint i;
+
+    g_return_if_fail (c != NULL);
+    g_return_if_fail (display != NULL);
+
+    if (w == None)
+    {
+        return;
+    }
+
+    refs = g_hash_table_lookup (display->client_windows, GUINT_TO_POINTER (w));
+    if (refs == NULL)
+    {
+        return;
+    }
+
+    for (i = 0; i < refs->len; i++)
+    {
+        ref = g_ptr_array_index (refs, i);
+        if (ref->c == c)
+        {
+            ref->mode &= ~mode;
+            if (ref->mode == 0)
+            {
+                g_ptr_array_remove_index (refs, i);
+            }
+            break;
+        }
+    }
+
+    if (refs->len == 0)
+    {
+        g_hash_table_remove (display->client_windows, GUINT_TO_POINTER (w));
+    }
+}
+
+void
+myDisplayAddClientFrameParts (DisplayInfo *display, Client *c)
+{
+    int i;
+
+    g_return_if_fail (c != NULL);
+    g_return_if_fail (display != NULL);
+
+    myDisplayAddClientWindow (display, c, MYWINDOW_XWINDOW (c->title), SEARCH_FRAME_PART);
+    for (i = 0; i < SIDE_COUNT; i++)
+    {
+        myDisplayAddClientWindow (display, c, MYWINDOW_XWINDOW (c->sides[i]), SEARCH_FRAME_PART);
+    }
+    for (i = 0; i < CORNER_COUNT; i++)
+    {
+        myDisplayAddClientWindow (display, c, MYWINDOW_XWINDOW (c->corners[i]), SEARCH_FRAME_PART);
+    }
+    for (i = 0; i < BUTTON_COUNT; i++)
+    {
+        myDisplayAddClientWindow (display, c, MYWINDOW_XWINDOW (c->buttons[i]), SEARCH_BUTTON);
+    }
+}
+
+void
+myDisplayRemoveClientFrameParts (DisplayInfo *display, Client *c)
+{
+    int i;
+
+    g_return_if_fail (c != NULL);
+    g_return_if_fail (display != NULL);
+
+    myDisplayRemoveClientWindow (display, c, MYWINDOW_XWINDOW (c->title), SEARCH_FRAME_PART);
+    for (i = 0; i < SIDE_COUNT; i++)
+    {
+        myDisplayRemoveClientWindow (display, c, MYWINDOW_XWINDOW (c->sides[i]), SEARCH_FRAME_PART);
+    }
+    for (i = 0; i < CORNER_COUNT; i++)
+    {
+        myDisplayRemoveClientWindow (display, c, MYWINDOW_XWINDOW (c->corners[i]), SEARCH_FRAME_PART);
+    }
+    for (i = 0; i < BUTTON_COUNT; i++)
+    {
+        myDisplayRemoveClientWindow (display, c, MYWINDOW_XWINDOW (c->buttons[i]), SEARCH_BUTTON);
+    }
+}
+
 void
 myDisplayAddClient (DisplayInfo *display, Client *c)
 {
@@ -507,6 +690,11 @@ myDisplayAddClient (DisplayInfo *display, Client *c)
     g_return_if_fail (display != NULL);
 
     display->clients = g_slist_append (display->clients, c);
+
+    myDisplayAddClientWindow (display, c, c->window, SEARCH_WINDOW);
+    myDisplayAddClientWindow (display, c, c->frame, SEARCH_FRAME);
+    myDisplayAddClientWindow (display, c, c->user_time_win, SEARCH_WIN_USER_TIME);
+    myDisplayAddClientFrameParts (display, c);
 }
 
 void
@@ -516,22 +704,33 @@ myDisplayRemoveClient (DisplayInfo *display, Client *c)
     g_return_if_fail (display != NULL);
 
     display->clients = g_slist_remove (display->clients, c);
+
+    myDisplayRemoveClientWindow (display, c, c->window, SEARCH_WINDOW);
+    myDisplayRemoveClientWindow (display, c, c->frame, SEARCH_FRAME);
+    myDisplayRemoveClientWindow (display, c, c->user_time_win, SEARCH_WIN_USER_TIME);
+    myDisplayRemoveClientFrameParts (display, c);
 }
 
 Client *
 myDisplayGetClientFromWindow (DisplayInfo *display, Window w, unsigned short mode)
 {
-    GSList *list;
+    GPtrArray *refs;
+    ClientWindowRef *ref;
+    guint i;
 
     g_return_val_if_fail (w != None, NULL);
     g_return_val_if_fail (display != NULL, NULL);
 
-    for (list = display->clients; list; list = g_slist_next (list))
+    refs = g_hash_table_lookup (display->client_windows, GUINT_TO_POINTER (w));
+    if (refs)
     {
-        Client *c = (Client *) list->data;
-        if (clientGetFromWindow (c, w, mode))
+        for (i = 0; i < refs->len; i++)
         {
-            return (c);
+            ref = g_ptr_array_index (refs, i);
+            if (ref->mode & mode)
+            {
+                return (ref->c);
+            }
         }
     }
     TRACE ("no client found");
@@ -675,21 +874,37 @@ myDisplayGetScreenFromSystray (DisplayInfo *display, Window w)
 #endif /* ENABLE_KDE_SYSTRAY_PROXY */
 
 #ifdef HAVE_XSYNC
+void
+myDisplayAddXSyncAlarm (DisplayInfo *display, XSyncAlarm xalarm, Client *c)
+{
+    g_return_if_fail (xalarm != None);
+    g_return_if_fail (c != NULL);
+    g_return_if_fail (display != NULL);
+
+    g_hash_table_insert (display->xsync_alarms, GUINT_TO_POINTER (xalarm), c);
+}
+
+void
+myDisplayRemoveXSyncAlarm (DisplayInfo *display, XSyncAlarm xalarm)
+{
+    g_return_if_fail (xalarm != None);
+    g_return_if_fail (display != NULL);
+
+    g_hash_table_remove (display->xsync_alarms, GUINT_TO_POINTER (xalarm));
+}
+
 Client *
 myDisplayGetClientFromXSyncAlarm (DisplayInfo *display, XSyncAlarm xalarm)
 {
-    GSList *list;
+    Client *c;
 
     g_return_val_if_fail (xalarm != None, NULL);
     g_return_val_if_fail (display != NULL, NULL);
 
-    for (list = display->clients; list; list = g_slist_next (list))
+    c = g_hash_table_lookup (display->xsync_alarms, GUINT_TO_POINTER (xalarm));
+    if (c)
     {
-        Client *c = (Client *) list->data;
-        if (xalarm == c->xsync_alarm)
-        {
-            return (c);
-        }
+        return (c);
     }
     TRACE ("no client found");
 
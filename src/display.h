@@ -83,7 +83,8 @@ enum
     SEARCH_WINDOW         = (1 << 0),
     SEARCH_FRAME          = (1 << 1),
     SEARCH_BUTTON         = (1 << 2),
-    SEARCH_WIN_USER_TIME  = (1 << 3)
+    SEARCH_WIN_USER_TIME  = (1 << 3),
+    SEARCH_FRAME_PART     = (1 << 4)
 };
 
 enum
@@ -274,6 +275,7 @@ enum
     WM_TRANSIENT_FOR,
     WM_WINDOW_ROLE,
     XFWM4_COMPOSITING_MANAGER,
+    XFWM4_COMPOSITOR_STATS,
     XFWM4_TIMESTAMP_PROP,
     XROOTPMAP,
     XSETROOT,
@@ -296,6 +298,8 @@ struct _DisplayInfo
     XfceSMClient *session;
     gboolean quit;
     gboolean reload;
+    gboolean dump_stats;
+    gboolean pending_props;
 
     Window timestamp_win;
     Cursor busy_cursor;
@@ -308,6 +312,16 @@ struct _DisplayInfo
     eventFilterSetup *xfilter;
     GSList *screens;
     GSList *clients;
+    GHashTable *client_windows;
+#ifdef HAVE_XCB
+    /* Properties fetched ahead while framing a client, see hints.c */
+    GHashTable *prefetched;
+#endif /* HAVE_XCB */
+    /* Property values of managed windows, see hints.c */
+    GHashTable *property_cache;
+    /* Frames waiting to be redrawn together, see frameQueueDraw() */
+    GSList *frame_draw_queue;
+    guint frame_draw_id;
 
     gboolean have_shape;
     gboolean have_render;
@@ -336,6 +350,7 @@ struct _DisplayInfo
 #ifdef HAVE_XSYNC
     gint xsync_event_base;
     gint xsync_error_base;
+    GHashTable *xsync_alarms;
 #endif /* HAVE_XSYNC */
 #ifdef HAVE_COMPOSITOR
     gint composite_error_base;
@@ -345,6 +360,7 @@ struct _DisplayInfo
     gint fixes_error_base;
     gint fixes_event_base;
     gint composite_mode;
+    GHashTable *cwindow_hash;
 
     gboolean have_composite;
     gboolean have_damage;
@@ -386,6 +402,18 @@ void                     myDisplayAddClient                     (DisplayInfo *,
                                                                  Client *);
 void                     myDisplayRemoveClient                  (DisplayInfo *,
                                                                  Client *);
+void                     myDisplayAddClientWindow               (DisplayInfo *,
+                                                                 Client *,
+                                                                 Window,
+                                                                 unsigned short);
+void                     myDisplayRemoveClientWindow            (DisplayInfo *,
+                                                                 Client *,
+                                                                 Window,
+                                                                 unsigned short);
+void                     myDisplayAddClientFrameParts           (DisplayInfo *,
+                                                                 Client *);
+void                     myDisplayRemoveClientFrameParts        (DisplayInfo *,
+                                                                 Client *);
 Client                  *myDisplayGetClientFromWindow           (DisplayInfo *,
                                                                  Window,
                                                                  unsigned short);
@@ -406,6 +434,11 @@ ScreenInfo              *myDisplayGetScreenFromSystray          (DisplayInfo *,
                                                                  Window);
 #endif /* ENABLE_KDE_SYSTRAY_PROXY */
 #ifdef HAVE_XSYNC
+void                     myDisplayAddXSyncAlarm                 (DisplayInfo *,
+                                                                 XSyncAlarm,
+                                                                 Client *);
+void                     myDisplayRemoveXSyncAlarm              (DisplayInfo *,
+                                                                 XSyncAlarm);
 Client                  *myDisplayGetClientFromXSyncAlarm       (DisplayInfo *,
                                                                  XSyncAlarm);
 #endif /* HAVE_XSYNC */
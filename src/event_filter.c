@@ -28,6 +28,7 @@
 #include <gdk/gdk.h>
 #include <gdk/gdkx.h>
 #include <X11/Xlib.h>
+#include <string.h>
 
 #include <libxfce4util/libxfce4util.h>
 #include "event_filter.h"
@@ -135,53 +136,134 @@ default_event_filter (XEvent * xevent, gpointer data)
     return EVENT_FILTER_STOP;
 }
 
+static void
+eventFilterFreeStale (eventFilterSetup *setup)
+{
+    g_slist_foreach (setup->stale, (GFunc) g_free, NULL);
+    g_slist_free (setup->stale);
+    setup->stale = NULL;
+}
+
+static void
+eventFilterUpdateDispatch (eventFilterSetup *setup)
+{
+    eventFilterStack *filterelt;
+    eventFilterStack **filters;
+    int type, n;
+
+    for (type = 0; type < EVENT_TYPE_COUNT; type++)
+    {
+        n = 0;
+        for (filterelt = setup->filterstack; filterelt; filterelt = filterelt->next)
+        {
+            if (filterelt->types[type / 32] & (1U << (type % 32)))
+            {
+                n++;
+            }
+        }
+
+        filters = g_new (eventFilterStack *, n + 1);
+        n = 0;
+        for (filterelt = setup->filterstack; filterelt; filterelt = filterelt->next)
+        {
+            if (filterelt->types[type / 32] & (1U << (type % 32)))
+            {
+                filters[n++] = filterelt;
+            }
+        }
+        filters[n] = NULL;
+
+        /* Do not pull the list from under an event being dispatched */
+        if (setup->dispatching)
+        {
+            setup->stale = g_slist_prepend (setup->stale, setup->dispatch[type]);
+        }
+        else
+        {
+            g_free (setup->dispatch[type]);
+        }
+        setup->dispatch[type] = filters;
+    }
+}
+
 static GdkFilterReturn
 eventXfwmFilter (GdkXEvent * gdk_xevent, GdkEvent * event, gpointer data)
 {
     XEvent *xevent;
     eventFilterStatus loop;
     eventFilterSetup *setup;
-    eventFilterStack *filterelt;
+    eventFilterStack **filters;
 
     setup = (eventFilterSetup *) data;
     g_return_val_if_fail (setup != NULL, GDK_FILTER_CONTINUE);
-
-    filterelt = setup->filterstack;
-    g_return_val_if_fail (filterelt != NULL, GDK_FILTER_CONTINUE);
+    g_return_val_if_fail (setup->filterstack != NULL, GDK_FILTER_CONTINUE);
 
     xevent = (XEvent *) gdk_xevent;
     loop = EVENT_FILTER_CONTINUE;
 
-    while ((filterelt) && (loop == EVENT_FILTER_CONTINUE))
+    /* Only run the filters which registered for that type of event */
+    setup->dispatching++;
+    filters = setup->dispatch[EVENT_TYPE_INDEX (xevent->type)];
+    while ((filters) && (*filters) && (loop == EVENT_FILTER_CONTINUE))
     {
-        eventFilterStack *filterelt_next = filterelt->next;
+        eventFilterStack *filterelt = *filters++;
         loop = (*filterelt->filter) (xevent, filterelt->data);
-        filterelt = filterelt_next;
     }
+    setup->dispatching--;
+
+    if ((setup->dispatching == 0) && (setup->stale))
+    {
+        eventFilterFreeStale (setup);
+    }
+
     return (loop & EVENT_FILTER_REMOVE) ? GDK_FILTER_REMOVE : GDK_FILTER_CONTINUE;
 }
 
-eventFilterStack *
-eventFilterPush (eventFilterSetup *setup, XfwmFilter filter, gpointer data)
+static eventFilterStack *
+eventFilterNew (eventFilterSetup *setup, XfwmFilter filter, gpointer data)
 {
+    eventFilterStack *newfilterstack;
+
     g_assert (filter != NULL);
-    if (setup->filterstack)
-    {
-        eventFilterStack *newfilterstack =
-            (eventFilterStack *) g_new (eventFilterStack, 1);
-        newfilterstack->filter = filter;
-        newfilterstack->data = data;
-        newfilterstack->next = setup->filterstack;
-        setup->filterstack = newfilterstack;
-    }
-    else
+
+    newfilterstack = g_new0 (eventFilterStack, 1);
+    newfilterstack->filter = filter;
+    newfilterstack->data = data;
+    newfilterstack->next = setup->filterstack;
+    setup->filterstack = newfilterstack;
+
+    return newfilterstack;
+}
+
+eventFilterStack *
+eventFilterPushTypes (eventFilterSetup *setup, XfwmFilter filter, gpointer data,
+                      const int *types, guint n_types)
+{
+    eventFilterStack *newfilterstack;
+    guint i;
+    int type;
+
+    newfilterstack = eventFilterNew (setup, filter, data);
+    for (i = 0; i < n_types; i++)
     {
-        setup->filterstack =
-            (eventFilterStack *) g_new (eventFilterStack, 1);
-        setup->filterstack->filter = filter;
-        setup->filterstack->data = data;
-        setup->filterstack->next = NULL;
+        type = EVENT_TYPE_INDEX (types[i]);
+        newfilterstack->types[type / 32] |= (1U << (type % 32));
     }
+    eventFilterUpdateDispatch (setup);
+
+    return (setup->filterstack);
+}
+
+eventFilterStack *
+eventFilterPush (eventFilterSetup *setup, XfwmFilter filter, gpointer data)
+{
+    eventFilterStack *newfilterstack;
+
+    /* Filters pushed without a list of types get all events */
+    newfilterstack = eventFilterNew (setup, filter, data);
+    memset (newfilterstack->types, 0xff, sizeof (newfilterstack->types));
+    eventFilterUpdateDispatch (setup);
+
     return (setup->filterstack);
 }
 
@@ -195,6 +277,7 @@ eventFilterPop (eventFilterSetup *setup)
     oldfilterstack = setup->filterstack;
     setup->filterstack = oldfilterstack->next;
     g_free (oldfilterstack);
+    eventFilterUpdateDispatch (setup);
 
     return (setup->filterstack);
 }
@@ -251,9 +334,17 @@ void
 eventFilterClose (eventFilterSetup *setup)
 {
     eventFilterStack *filterelt;
+    int type;
 
     filterelt = setup->filterstack;
     while ((filterelt = eventFilterPop (setup)));
     gdk_window_remove_filter (NULL, eventXfwmFilter, NULL);
     setup->filterstack = NULL;
+
+    eventFilterFreeStale (setup);
+    for (type = 0; type < EVENT_TYPE_COUNT; type++)
+    {
+        g_free (setup->dispatch[type]);
+        setup->dispatch[type] = NULL;
+    }
 }
@@ -42,10 +42,16 @@ eventFilterStatus;
 
 typedef eventFilterStatus (*XfwmFilter) (XEvent * xevent, gpointer data);
 
+/* Core and extension event types all fit in 7 bits */
+#define EVENT_TYPE_COUNT                128
+#define EVENT_TYPE_INDEX(type)          ((type) & (EVENT_TYPE_COUNT - 1))
+
 typedef struct eventFilterStack
 {
     XfwmFilter filter;
     gpointer data;
+    /* Bitmask of the event types the filter is interested in */
+    guint32 types[EVENT_TYPE_COUNT / 32];
     struct eventFilterStack *next;
 }
 eventFilterStack;
@@ -53,6 +59,11 @@ eventFilterStack;
 typedef struct eventFilterSetup
 {
     eventFilterStack *filterstack;
+    /* For each event type, the NULL terminated list of filters to run, top of the stack first */
+    eventFilterStack **dispatch[EVENT_TYPE_COUNT];
+    /* Lists replaced while an event was being dispatched */
+    GSList *stale;
+    gint dispatching;
 }
 eventFilterSetup;
 
@@ -61,6 +72,11 @@ GdkWindow               *eventFilterAddWin                      (GdkScreen *,
 eventFilterStack        *eventFilterPush                        (eventFilterSetup *,
                                                                  XfwmFilter,
                                                                  gpointer );
+eventFilterStack        *eventFilterPushTypes                   (eventFilterSetup *,
+                                                                 XfwmFilter,
+                                                                 gpointer,
+                                                                 const int *,
+                                                                 guint);
 eventFilterStack        *eventFilterPop                         (eventFilterSetup *);
 eventFilterSetup        *eventFilterInit                        (gpointer);
 void                     eventFilterClose                       (eventFilterSetup *);
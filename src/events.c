@@ -80,8 +80,30 @@
                                  ButtonPressMask | \
                                  ButtonReleaseMask)
 
+/* Processing time histograms, bucket i is for durations below 2^i usec */
+#define EVENT_STATS_BUCKETS     16
+
+typedef struct
+{
+    guint64 count;
+    gint64 wm_time;
+    gint64 compositor_time;
+    /* Time spent in handleEventsDrained() after the event */
+    gint64 drained_time;
+    gint64 max_time;
+    guint64 queued;
+    int max_queued;
+    guint64 wm_histogram[EVENT_STATS_BUCKETS];
+    guint64 compositor_histogram[EVENT_STATS_BUCKETS];
+    guint64 drained_histogram[EVENT_STATS_BUCKETS];
+}
+eventTypeStats;
+
 static GdkAtom atom_rcfiles = GDK_NONE;
 static xfwmWindow menu_event_window;
+/* Only allocated when event statistics are enabled */
+static eventTypeStats *event_stats = NULL;
+static gchar *event_stats_file = NULL;
 
 /* Forward decl. */
 
@@ -1119,6 +1141,7 @@ handleDestroyNotify (DisplayInfo *display_info, XDestroyWindowEvent * ev)
     TRACE ("DestroyNotify on window (0x%lx)", ev->window);
 
     status = EVENT_FILTER_PASS;
+    forgetCachedHints (display_info, ev->window);
 #ifdef ENABLE_KDE_SYSTRAY_PROXY
     screen_info = myDisplayGetScreenFromSystray (display_info, ev->window);
     if (screen_info)
@@ -1684,6 +1707,7 @@ handlePropertyNotify (DisplayInfo *display_info, XPropertyEvent * ev)
     TRACE ("entering handlePropertyNotify");
 
     status = EVENT_FILTER_PASS;
+    invalidateCachedHint (display_info, ev->window, ev->atom);
     c = myDisplayGetClientFromWindow (display_info, ev->window, SEARCH_WINDOW | SEARCH_WIN_USER_TIME);
     if (c)
     {
@@ -1699,7 +1723,7 @@ handlePropertyNotify (DisplayInfo *display_info, XPropertyEvent * ev)
                  (ev->atom == display_info->atoms[WM_CLIENT_MACHINE]))
         {
             TRACE ("client \"%s\" (0x%lx) has received a XA_WM_NAME/NET_WM_NAME/WM_CLIENT_MACHINE notify", c->name, c->window);
-            clientUpdateName (c);
+            clientQueuePropUpdate (c, PENDING_PROP_NAME);
         }
         else if (ev->atom == display_info->atoms[MOTIF_WM_HINTS])
         {
@@ -1767,10 +1791,7 @@ handlePropertyNotify (DisplayInfo *display_info, XPropertyEvent * ev)
                  (ev->atom == display_info->atoms[NET_WM_STRUT_PARTIAL]))
         {
             TRACE ("client \"%s\" (0x%lx) has received a NET_WM_STRUT notify", c->name, c->window);
-            if (clientGetNetStruts (c) && FLAG_TEST (c->xfwm_flags, XFWM_FLAG_VISIBLE))
-            {
-                workspaceUpdateArea (c->screen_info);
-            }
+            clientQueuePropUpdate (c, PENDING_PROP_STRUTS);
         }
         else if (ev->atom == display_info->atoms[WM_COLORMAP_WINDOWS])
         {
@@ -1804,11 +1825,7 @@ handlePropertyNotify (DisplayInfo *display_info, XPropertyEvent * ev)
         else if (ev->atom == display_info->atoms[NET_WM_WINDOW_OPACITY])
         {
             TRACE ("client \"%s\" (0x%lx) has received a NET_WM_WINDOW_OPACITY notify", c->name, c->window);
-            if (!getOpacity (display_info, c->window, &c->opacity))
-            {
-                c->opacity =  NET_WM_OPAQUE;
-            }
-            clientSetOpacity (c, c->opacity, 0, 0);
+            clientQueuePropUpdate (c, PENDING_PROP_OPACITY);
         }
         else if (ev->atom == display_info->atoms[NET_WM_WINDOW_OPACITY_LOCKED])
         {
@@ -2178,14 +2195,209 @@ handleXSyncAlarmNotify (DisplayInfo *display_info, XSyncAlarmNotifyEvent * ev)
 }
 #endif /* HAVE_XSYNC */
 
+static guint
+event_stats_bucket (gint64 usec)
+{
+    guint bucket;
+
+    bucket = 0;
+    while ((usec > 0) && (bucket < EVENT_STATS_BUCKETS - 1))
+    {
+        usec >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+static void
+event_stats_record (int type, int queued, gint64 wm_time, gint64 compositor_time,
+                    gint64 drained_time)
+{
+    eventTypeStats *stats;
+    gint64 total;
+
+    stats = &event_stats[EVENT_TYPE_INDEX (type)];
+    total = wm_time + compositor_time + drained_time;
+
+    stats->count++;
+    stats->wm_time += wm_time;
+    stats->compositor_time += compositor_time;
+    stats->drained_time += drained_time;
+    stats->max_time = MAX (stats->max_time, total);
+    stats->queued += queued;
+    stats->max_queued = MAX (stats->max_queued, queued);
+    stats->wm_histogram[event_stats_bucket (wm_time)]++;
+    stats->compositor_histogram[event_stats_bucket (compositor_time)]++;
+    stats->drained_histogram[event_stats_bucket (drained_time)]++;
+}
+
+static const gchar *
+event_stats_type_name (DisplayInfo *display_info, int type)
+{
+    static const gchar *core_names[LASTEvent] = {
+        NULL, NULL, "KeyPress", "KeyRelease", "ButtonPress", "ButtonRelease",
+        "MotionNotify", "EnterNotify", "LeaveNotify", "FocusIn", "FocusOut",
+        "KeymapNotify", "Expose", "GraphicsExpose", "NoExpose", "VisibilityNotify",
+        "CreateNotify", "DestroyNotify", "UnmapNotify", "MapNotify", "MapRequest",
+        "ReparentNotify", "ConfigureNotify", "ConfigureRequest", "GravityNotify",
+        "ResizeRequest", "CirculateNotify", "CirculateRequest", "PropertyNotify",
+        "SelectionClear", "SelectionRequest", "SelectionNotify", "ColormapNotify",
+        "ClientMessage", "MappingNotify", "GenericEvent"
+    };
+
+    if ((type < LASTEvent) && (core_names[type]))
+    {
+        return core_names[type];
+    }
+    if ((display_info->have_shape) && (type == display_info->shape_event_base + ShapeNotify))
+    {
+        return "ShapeNotify";
+    }
+#ifdef HAVE_XSYNC
+    if ((display_info->have_xsync) && (type == display_info->xsync_event_base + XSyncAlarmNotify))
+    {
+        return "XSyncAlarmNotify";
+    }
+#endif /* HAVE_XSYNC */
+#ifdef HAVE_COMPOSITOR
+    if ((display_info->have_damage) && (type == display_info->damage_event_base + XDamageNotify))
+    {
+        return "XDamageNotify";
+    }
+    if ((display_info->have_fixes) && (type == display_info->fixes_event_base + XFixesCursorNotify))
+    {
+        return "XFixesCursorNotify";
+    }
+#endif /* HAVE_COMPOSITOR */
+
+    return "Unknown";
+}
+
+static void
+event_stats_append_histogram (GString *str, const gchar *name, const guint64 *histogram)
+{
+    guint i;
+
+    g_string_append_printf (str, ", \"%s\": [", name);
+    for (i = 0; i < EVENT_STATS_BUCKETS; i++)
+    {
+        g_string_append_printf (str, "%s%" G_GUINT64_FORMAT, i ? ", " : "", histogram[i]);
+    }
+    g_string_append (str, "]");
+}
+
+static void
+dumpEventStats (DisplayInfo *display_info)
+{
+    eventTypeStats *stats;
+    GString *str;
+    GError *error;
+    gboolean first;
+    int type;
+    guint i;
+
+    TRACE ("entering dumpEventStats");
+
+    /* Bucket 0 is under 1 usec, bucket i covers [2^(i-1), 2^i) usec, the last one is unbounded */
+    str = g_string_new ("{\n  \"bucket_lower_bounds_usec\": [0");
+    for (i = 1; i < EVENT_STATS_BUCKETS; i++)
+    {
+        g_string_append_printf (str, ", %u", 1U << (i - 1));
+    }
+    g_string_append (str, "],\n  \"events\": [");
+
+    first = TRUE;
+    for (type = 0; type < EVENT_TYPE_COUNT; type++)
+    {
+        stats = &event_stats[type];
+        if (stats->count == 0)
+        {
+            continue;
+        }
+        g_string_append_printf (str, "%s\n    { \"type\": %i, \"name\": ", first ? "" : ",", type);
+        appendJsonString (str, event_stats_type_name (display_info, type));
+        g_string_append_printf (str, ", \"count\": %" G_GUINT64_FORMAT
+                                ", \"wm_usec\": %" G_GINT64_FORMAT ", \"compositor_usec\": %" G_GINT64_FORMAT
+                                ", \"drained_usec\": %" G_GINT64_FORMAT ", \"max_usec\": %" G_GINT64_FORMAT
+                                ", \"queued_total\": %" G_GUINT64_FORMAT ", \"queued_max\": %i",
+                                stats->count, stats->wm_time, stats->compositor_time, stats->drained_time,
+                                stats->max_time, stats->queued, stats->max_queued);
+        event_stats_append_histogram (str, "wm_histogram", stats->wm_histogram);
+        event_stats_append_histogram (str, "compositor_histogram", stats->compositor_histogram);
+        event_stats_append_histogram (str, "drained_histogram", stats->drained_histogram);
+        g_string_append (str, " }");
+        first = FALSE;
+    }
+    g_string_append (str, "\n  ]\n}\n");
+
+    error = NULL;
+    if (!g_file_set_contents (event_stats_file, str->str, str->len, &error))
+    {
+        g_warning ("Cannot write event statistics: %s", error->message);
+        g_error_free (error);
+    }
+    g_string_free (str, TRUE);
+}
+
+static void
+handleEventsDrained (DisplayInfo *display_info)
+{
+    if (!gdk_events_pending () && !XPending (display_info->dpy))
+    {
+        const gchar *operation;
+
+        /* Process the property changes collected since the queue last drained */
+        operation = setPropertyStatsOperation ("property change");
+        clientFlushPendingProps (display_info);
+        setPropertyStatsOperation (operation);
+        if (display_info->dump_stats)
+        {
+            compositorDumpStats (display_info);
+            if (event_stats)
+            {
+                dumpEventStats (display_info);
+            }
+            dumpPropertyStats (display_info);
+            display_info->dump_stats = FALSE;
+        }
+        if (display_info->reload)
+        {
+            reloadSettings (display_info, UPDATE_ALL);
+            display_info->reload = FALSE;
+        }
+        else if (display_info->quit)
+        {
+            /*
+             * Qutting on purpose, update session manager so
+             * it does not restart the program immediately
+             */
+            xfce_sm_client_set_restart_style(display_info->session, XFCE_SM_CLIENT_RESTART_NORMAL);
+            gtk_main_quit ();
+        }
+    }
+}
+
 static eventFilterStatus
 handleEvent (DisplayInfo *display_info, XEvent * ev)
 {
     eventFilterStatus status;
+    const gchar *operation;
+    gint64 start, wm_end, drained_end;
+    int queued;
+
     status = EVENT_FILTER_PASS;
+    start = wm_end = drained_end = 0;
+    queued = 0;
 
     TRACE ("entering handleEvent");
 
+    if (G_UNLIKELY (event_stats))
+    {
+        queued = XEventsQueued (display_info->dpy, QueuedAlready);
+        start = g_get_monotonic_time ();
+    }
+
     /* Update the display time */
     myDisplayUpdateCurrentTime (display_info, ev);
     sn_process_event (ev);
@@ -2213,7 +2425,9 @@ handleEvent (DisplayInfo *display_info, XEvent * ev)
             status = handleUnmapNotify (display_info, (XUnmapEvent *) ev);
             break;
         case MapRequest:
+            operation = setPropertyStatsOperation ("map");
             status = handleMapRequest (display_info, (XMapRequestEvent *) ev);
+            setPropertyStatsOperation (operation);
             break;
         case MapNotify:
             status = handleMapNotify (display_info, (XMapEvent *) ev);
@@ -2237,7 +2451,9 @@ handleEvent (DisplayInfo *display_info, XEvent * ev)
             status = handleFocusOut (display_info, (XFocusChangeEvent *) ev);
             break;
         case PropertyNotify:
+            operation = setPropertyStatsOperation ("property change");
             status = handlePropertyNotify (display_info, (XPropertyEvent *) ev);
+            setPropertyStatsOperation (operation);
             break;
         case ClientMessage:
             status = handleClientMessage (display_info, (XClientMessageEvent *) ev);
@@ -2264,26 +2480,24 @@ handleEvent (DisplayInfo *display_info, XEvent * ev)
 #endif /* HAVE_XSYNC */
             break;
     }
-    if (!gdk_events_pending () && !XPending (display_info->dpy))
+    if (G_UNLIKELY (event_stats))
     {
-        if (display_info->reload)
-        {
-            reloadSettings (display_info, UPDATE_ALL);
-            display_info->reload = FALSE;
-        }
-        else if (display_info->quit)
-        {
-            /*
-             * Qutting on purpose, update session manager so
-             * it does not restart the program immediately
-             */
-            xfce_sm_client_set_restart_style(display_info->session, XFCE_SM_CLIENT_RESTART_NORMAL);
-            gtk_main_quit ();
-        }
+        wm_end = g_get_monotonic_time ();
     }
+    handleEventsDrained (display_info);
 
+    if (G_UNLIKELY (event_stats))
+    {
+        drained_end = g_get_monotonic_time ();
+    }
     compositorHandleEvent (display_info, ev);
 
+    if (G_UNLIKELY (event_stats))
+    {
+        event_stats_record (ev->type, queued, wm_end - start,
+                            g_get_monotonic_time () - drained_end, drained_end - wm_end);
+    }
+
     return status;
 }
 
@@ -2301,6 +2515,108 @@ xfwm4_event_filter (XEvent * xevent, gpointer data)
     return EVENT_FILTER_STOP | status;
 }
 
+static eventFilterStatus
+xfwm4_compositor_event_filter (XEvent * xevent, gpointer data)
+{
+    DisplayInfo *display_info;
+
+    display_info = (DisplayInfo *) data;
+
+    TRACE ("entering xfwm4_compositor_event_filter");
+    if (G_UNLIKELY (event_stats))
+    {
+        int queued;
+        gint64 start, compositor_end;
+
+        queued = XEventsQueued (display_info->dpy, QueuedAlready);
+        start = g_get_monotonic_time ();
+        compositorHandleEvent (display_info, xevent);
+        compositor_end = g_get_monotonic_time ();
+        handleEventsDrained (display_info);
+        event_stats_record (xevent->type, queued, 0, compositor_end - start,
+                            g_get_monotonic_time () - compositor_end);
+    }
+    else
+    {
+        compositorHandleEvent (display_info, xevent);
+        handleEventsDrained (display_info);
+    }
+    TRACE ("leaving xfwm4_compositor_event_filter");
+    return EVENT_FILTER_STOP;
+}
+
+void
+initEventStats (DisplayInfo *display_info, const gchar *filename)
+{
+    g_return_if_fail (display_info != NULL);
+    g_return_if_fail (filename != NULL);
+    TRACE ("entering initEventStats");
+
+    g_free (event_stats_file);
+    event_stats_file = g_strdup (filename);
+    if (event_stats == NULL)
+    {
+        event_stats = g_new0 (eventTypeStats, EVENT_TYPE_COUNT);
+    }
+}
+
+void
+initEventFilters (DisplayInfo *display_info)
+{
+    int wm_types[LASTEvent + 2];
+    int compositor_types[LASTEvent + 2];
+    guint n_wm, n_compositor;
+    int type;
+
+    g_return_if_fail (display_info != NULL);
+    g_return_if_fail (display_info->xfilter != NULL);
+    TRACE ("entering initEventFilters");
+
+    n_wm = 0;
+    n_compositor = 0;
+    for (type = KeyPress; type < LASTEvent; type++)
+    {
+        switch (type)
+        {
+            /* Only the compositor cares about these */
+            case CreateNotify:
+            case Expose:
+            case CirculateNotify:
+            case GenericEvent:
+                compositor_types[n_compositor++] = type;
+                break;
+            default:
+                wm_types[n_wm++] = type;
+                break;
+        }
+    }
+    if (display_info->have_shape)
+    {
+        wm_types[n_wm++] = display_info->shape_event_base + ShapeNotify;
+    }
+#ifdef HAVE_XSYNC
+    if (display_info->have_xsync)
+    {
+        wm_types[n_wm++] = display_info->xsync_event_base + XSyncAlarmNotify;
+    }
+#endif /* HAVE_XSYNC */
+#ifdef HAVE_COMPOSITOR
+    if (display_info->have_damage)
+    {
+        compositor_types[n_compositor++] = display_info->damage_event_base + XDamageNotify;
+    }
+    if (display_info->have_fixes)
+    {
+        compositor_types[n_compositor++] = display_info->fixes_event_base + XFixesCursorNotify;
+    }
+#endif /* HAVE_COMPOSITOR */
+
+    eventFilterPushTypes (display_info->xfilter, xfwm4_compositor_event_filter,
+                          (gpointer) display_info, compositor_types, n_compositor);
+    eventFilterPushTypes (display_info->xfilter, xfwm4_event_filter,
+                          (gpointer) display_info, wm_types, n_wm);
+}
+
 /* GTK specific stuff */
 
 static void
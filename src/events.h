@@ -40,6 +40,9 @@
 void                     initMenuEventWin                       (void);
 eventFilterStatus        xfwm4_event_filter                     (XEvent *,
                                                                  gpointer);
+void                     initEventFilters                       (DisplayInfo *);
+void                     initEventStats                         (DisplayInfo *,
+                                                                 const gchar *);
 void                     initPerScreenCallbacks                 (ScreenInfo *);
 void                     initPerDisplayCallbacks                (DisplayInfo *);
 #endif /* INC_EVENTS_H */
@@ -530,8 +530,8 @@ clientUpdateFocus (ScreenInfo *screen_info, Client * c, unsigned short flags)
     pending_focus = NULL;
 }
 
-void
-clientSetFocus (ScreenInfo *screen_info, Client *c, guint32 timestamp, unsigned short flags)
+static void
+client_set_focus (ScreenInfo *screen_info, Client *c, guint32 timestamp, unsigned short flags)
 {
     Client *c2;
 
@@ -612,6 +612,16 @@ clientSetFocus (ScreenInfo *screen_info, Client *c, guint32 timestamp, unsigned
     }
 }
 
+void
+clientSetFocus (ScreenInfo *screen_info, Client *c, guint32 timestamp, unsigned short flags)
+{
+    const gchar *operation;
+
+    operation = setPropertyStatsOperation ("focus change");
+    client_set_focus (screen_info, c, timestamp, flags);
+    setPropertyStatsOperation (operation);
+}
+
 void
 clientInitFocusFlag (Client * c)
 {
@@ -465,6 +465,39 @@ frameFillTitlePixmap (Client * c, int state, int part, int x, int w, int h, xfwm
     xfwmPixmapFill (&screen_info->title[part][frameGetColorIndex(c, state)], title_pm, x, 0, w, frameTop (c));
 }
 
+/*
+ * Shaping the title is the expensive part of a frame redraw, yet only the
+ * name and the font affect it, so the layout is kept with the client and
+ * reused for both states and any frame size.
+ */
+static PangoLayout *
+frameGetTitleLayout (Client * c)
+{
+    ScreenInfo *screen_info;
+
+    screen_info = c->screen_info;
+
+    if ((c->title_layout) && (c->title_layout_serial == screen_info->font_serial))
+    {
+        /* Setting the same text again would still discard the shaping */
+        if (g_strcmp0 (pango_layout_get_text (c->title_layout), c->name ? c->name : ""))
+        {
+            pango_layout_set_text (c->title_layout, c->name ? c->name : "", -1);
+        }
+        return c->title_layout;
+    }
+
+    if (c->title_layout)
+    {
+        g_object_unref (G_OBJECT (c->title_layout));
+    }
+    c->title_layout = gtk_widget_create_pango_layout (myScreenGetGtkWidget (screen_info), c->name);
+    pango_layout_set_auto_dir (c->title_layout, FALSE);
+    c->title_layout_serial = screen_info->font_serial;
+
+    return c->title_layout;
+}
+
 static void
 frameCreateTitlePixmap (Client * c, int state, int left, int right, xfwmPixmap * title_pm, xfwmPixmap * top_pm)
 {
@@ -533,8 +566,7 @@ frameCreateTitlePixmap (Client * c, int state, int left, int right, xfwmPixmap *
             voffset = screen_info->params->title_vertical_offset_inactive;
     }
 
-    layout = gtk_widget_create_pango_layout (myScreenGetGtkWidget (screen_info), c->name);
-    pango_layout_set_auto_dir (layout, FALSE);
+    layout = frameGetTitleLayout (c);
     pango_layout_get_pixel_extents (layout, NULL, &logical_rect);
 
     title_height = screen_info->font_height;
@@ -626,7 +658,9 @@ frameCreateTitlePixmap (Client * c, int state, int left, int right, xfwmPixmap *
 
     xfwmPixmapCreate (screen_info, top_pm, width, top_height);
     xfwmPixmapCreate (screen_info, title_pm, width, frameTop (c));
-    gpixmap = gdk_pixmap_foreign_new (title_pm->pixmap);
+    /* Size and depth are known, saves a round trip on each redraw */
+    gpixmap = gdk_pixmap_foreign_new_for_screen (screen_info->gscr, title_pm->pixmap,
+                                                 width, frameTop (c), screen_info->depth);
     gdk_drawable_set_colormap (gpixmap, gdk_screen_get_rgb_colormap (screen_info->gscr));
     gc = gdk_gc_new (gpixmap);
 
@@ -678,7 +712,6 @@ frameCreateTitlePixmap (Client * c, int state, int left, int right, xfwmPixmap *
     }
     g_object_unref (G_OBJECT (gc));
     g_object_unref (G_OBJECT (gpixmap));
-    g_object_unref (G_OBJECT (layout));
 }
 
 static int
@@ -1063,6 +1096,32 @@ frameSetShapeInput (Client * c)
     XShapeCombineShape(display_info->dpy, c->frame, ShapeInput, 0, 0, screen_info->shape_win, ShapeInput, ShapeSet);
 }
 
+/*
+ * Opaque sides are plain tiles, so the theme pixmap uploaded once at load
+ * time is used as the window background as is and the server does the
+ * tiling, nothing gets allocated when the frame is resized. Sides with a
+ * shape still need a mask of the actual size.
+ */
+static void
+frameSetSideBG (Client * c, int state, int side, xfwmPixmap * side_pm, int width, int height)
+{
+    ScreenInfo *screen_info;
+    xfwmPixmap *tile;
+
+    screen_info = c->screen_info;
+    tile = &screen_info->sides[side][frameGetColorIndex(c, state)];
+
+    if (tile->opaque)
+    {
+        xfwmWindowSetBG (&c->sides[side], tile);
+        return;
+    }
+
+    xfwmPixmapCreate (screen_info, side_pm, width, height);
+    xfwmPixmapFill (tile, side_pm, 0, 0, width, height);
+    xfwmWindowSetBG (&c->sides[side], side_pm);
+}
+
 static void
 frameDrawWin (Client * c)
 {
@@ -1082,8 +1141,6 @@ frameDrawWin (Client * c)
 
     g_return_if_fail (c != NULL);
 
-    frameClearQueueDraw (c);
-
     screen_info = c->screen_info;
     requires_clearing = FALSE;
     width_changed = FALSE;
@@ -1291,35 +1348,20 @@ frameDrawWin (Client * c)
             }
             else
             {
-                xfwmPixmapCreate (screen_info, &frame_pix.pm_sides[SIDE_LEFT],
+                frameSetSideBG (c, state, SIDE_LEFT, &frame_pix.pm_sides[SIDE_LEFT],
                     frameLeft (c), left_height);
-                xfwmPixmapFill (&screen_info->sides[SIDE_LEFT][frameGetColorIndex(c, state)],
-                    &frame_pix.pm_sides[SIDE_LEFT],
-                    0, 0, frameLeft (c), left_height);
-                xfwmWindowSetBG (&c->sides[SIDE_LEFT],
-                    &frame_pix.pm_sides[SIDE_LEFT]);
                 xfwmWindowShow (&c->sides[SIDE_LEFT], 0, frameTop (c),
                     frameLeft (c), left_height, (requires_clearing | height_changed));
 
-                xfwmPixmapCreate (screen_info, &frame_pix.pm_sides[SIDE_RIGHT],
+                frameSetSideBG (c, state, SIDE_RIGHT, &frame_pix.pm_sides[SIDE_RIGHT],
                     frameRight (c), right_height);
-                xfwmPixmapFill (&screen_info->sides[SIDE_RIGHT][frameGetColorIndex(c, state)],
-                    &frame_pix.pm_sides[SIDE_RIGHT],
-                    0, 0, frameRight (c), right_height);
-                xfwmWindowSetBG (&c->sides[SIDE_RIGHT],
-                    &frame_pix.pm_sides[SIDE_RIGHT]);
                 xfwmWindowShow (&c->sides[SIDE_RIGHT],
                     frameWidth (c) - frameRight (c), frameTop (c), frameRight (c),
                     right_height, (requires_clearing | height_changed));
             }
 
-            xfwmPixmapCreate (screen_info, &frame_pix.pm_sides[SIDE_BOTTOM],
+            frameSetSideBG (c, state, SIDE_BOTTOM, &frame_pix.pm_sides[SIDE_BOTTOM],
                 bottom_width, frameBottom (c));
-            xfwmPixmapFill (&screen_info->sides[SIDE_BOTTOM][frameGetColorIndex(c, state)],
-                &frame_pix.pm_sides[SIDE_BOTTOM],
-                0, 0, bottom_width, frameBottom (c));
-            xfwmWindowSetBG (&c->sides[SIDE_BOTTOM],
-                &frame_pix.pm_sides[SIDE_BOTTOM]);
             xfwmWindowShow (&c->sides[SIDE_BOTTOM],
                 screen_info->corners[CORNER_BOTTOM_LEFT][frameGetColorIndex(c, state)].width,
                 frameHeight (c) - frameBottom (c), bottom_width, frameBottom (c),
@@ -1404,18 +1446,39 @@ frameDrawWin (Client * c)
     }
 }
 
+/*
+ * Queued redraws are gathered per display and done in one go, so that a
+ * focus change or a theme reload sends the requests of all the frames
+ * involved in a single burst, and a frame queued several times in the
+ * meantime, including its shape, is only updated once.
+ */
 static gboolean
-update_frame_idle_cb (gpointer data)
+update_frames_idle_cb (gpointer data)
 {
+    DisplayInfo *display_info;
+    GSList *queue, *list;
     Client *c;
 
-    TRACE ("entering update_frame_idle_cb");
+    TRACE ("entering update_frames_idle_cb");
 
-    c = (Client *) data;
-    g_return_val_if_fail (c, FALSE);
+    display_info = (DisplayInfo *) data;
+    g_return_val_if_fail (display_info, FALSE);
 
-    frameDrawWin (c);
-    c->frame_timeout_id = 0;
+    display_info->frame_draw_id = 0;
+
+    /* Frames queued while drawing go to the next batch */
+    queue = g_slist_reverse (display_info->frame_draw_queue);
+    display_info->frame_draw_queue = NULL;
+
+    for (list = queue; list; list = g_slist_next (list))
+    {
+        c = (Client *) list->data;
+        c->frame_queued = FALSE;
+        frameDrawWin (c);
+    }
+    g_slist_free (queue);
+
+    XFlush (display_info->dpy);
 
     return (FALSE);
 }
@@ -1423,14 +1486,25 @@ update_frame_idle_cb (gpointer data)
 void
 frameClearQueueDraw (Client * c)
 {
+    DisplayInfo *display_info;
+
     g_return_if_fail (c);
 
     TRACE ("entering frameClearQueueDraw for \"%s\" (0x%lx)", c->name, c->window);
 
-    if (c->frame_timeout_id)
+    if (!c->frame_queued)
     {
-        g_source_remove (c->frame_timeout_id);
-        c->frame_timeout_id = 0;
+        return;
+    }
+
+    display_info = c->screen_info->display_info;
+    display_info->frame_draw_queue = g_slist_remove (display_info->frame_draw_queue, c);
+    c->frame_queued = FALSE;
+
+    if ((display_info->frame_draw_queue == NULL) && (display_info->frame_draw_id))
+    {
+        g_source_remove (display_info->frame_draw_id);
+        display_info->frame_draw_id = 0;
     }
 }
 
@@ -1441,6 +1515,8 @@ frameDraw (Client * c, gboolean clear_all)
 
     TRACE ("entering frameDraw for \"%s\" (0x%lx)", c->name, c->window);
 
+    /* Drawn now, no need to draw it again with the next batch */
+    frameClearQueueDraw (c);
     if (clear_all)
     {
         FLAG_SET (c->xfwm_flags, XFWM_FLAG_NEEDS_REDRAW);
@@ -1451,24 +1527,29 @@ frameDraw (Client * c, gboolean clear_all)
 void
 frameQueueDraw (Client * c, gboolean clear_all)
 {
+    DisplayInfo *display_info;
+
     g_return_if_fail (c);
 
     TRACE ("entering frameQueueDraw for \"%s\" (0x%lx)", c->name, c->window);
 
-    /* Reschedule update */
-    if (c->frame_timeout_id)
-    {
-        frameClearQueueDraw (c);
-    }
+    display_info = c->screen_info->display_info;
+
     if (clear_all)
     {
         FLAG_SET (c->xfwm_flags, XFWM_FLAG_NEEDS_REDRAW);
     }
-    /* Otherwise leave previous schedule */
-    if (c->frame_timeout_id == 0)
+    /* Already queued frames keep their place in the batch */
+    if (!c->frame_queued)
+    {
+        display_info->frame_draw_queue = g_slist_prepend (display_info->frame_draw_queue, c);
+        c->frame_queued = TRUE;
+    }
+    if (display_info->frame_draw_id == 0)
     {
-        c->frame_timeout_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
-                                              update_frame_idle_cb, c, NULL);
+        display_info->frame_draw_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+                                                       update_frames_idle_cb,
+                                                       display_info, NULL);
     }
 }
 
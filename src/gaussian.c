@@ -0,0 +1,129 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+        xcompmgr - (c) 2003 Keith Packard
+        xfwm4    - (c) 2005-2015 Olivier Fourdan
+
+        The gaussian kernel used for the compositor shadows. It has no
+        dependency on the rest of xfwm4, so the shadow benchmark can check
+        it against the reference double precision sums.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <math.h>
+#include <libxfce4util/libxfce4util.h>
+
+#include "gaussian.h"
+
+static gdouble
+gaussian (gdouble r, gdouble x)
+{
+    return ((1 / (sqrt (2 * G_PI * r))) *
+            exp ((- (x * x)) / (2 * r * r)));
+}
+
+/*
+ * The 2D gaussian is the product of two 1D gaussians, so only the 1D
+ * kernel is kept, as fixed point prefix sums: sums[i] is the normalized
+ * weight of the kernel entries before i, and sums[size] is GAUSSIAN_ONE.
+ * The map is freed with g_free().
+ */
+gaussian_conv *
+gaussianMapNew (gdouble r)
+{
+    gaussian_conv *c;
+    gint size, center;
+    gint x;
+    gdouble t, s;
+
+    TRACE ("entering gaussianMapNew");
+
+    size = ((gint) ceil ((r * 3)) + 1) & ~1;
+    center = size / 2;
+    c = g_malloc (sizeof (gaussian_conv) + (size + 1) * sizeof (guint32));
+    c->size = size;
+    c->sums = (guint32 *) (c + 1);
+
+    t = 0.0;
+    for (x = 0; x < size; x++)
+    {
+        t += gaussian (r, (gdouble) (x - center));
+    }
+
+    s = 0.0;
+    c->sums[0] = 0;
+    for (x = 0; x < size; x++)
+    {
+        s += gaussian (r, (gdouble) (x - center));
+        c->sums[x + 1] = (guint32) (s / t * GAUSSIAN_ONE + 0.5);
+    }
+    c->sums[size] = GAUSSIAN_ONE;
+
+    return c;
+}
+
+/*
+* A picture will help
+*
+*      -center   0                width  width+center
+*  -center +-----+-------------------+-----+
+*          |     |                   |     |
+*          |     |                   |     |
+*        0 +-----+-------------------+-----+
+*          |     |                   |     |
+*          |     |                   |     |
+*          |     |                   |     |
+*   height +-----+-------------------+-----+
+*          |     |                   |     |
+* height+  |     |                   |     |
+*  center  +-----+-------------------+-----+
+*/
+
+guchar
+gaussianSum (gaussian_conv *map, gdouble opacity, gint x, gint y, gint width, gint height)
+{
+    guint64 v, o;
+    gint fx_start, fx_end;
+    gint fy_start, fy_end;
+    gint g_size, center;
+
+    g_return_val_if_fail (map != NULL, (guchar) 255.0);
+    TRACE ("entering gaussianSum");
+
+    g_size = map->size;
+    center = g_size / 2;
+    fx_start = CLAMP (center - x, 0, g_size);
+    fx_end = CLAMP (width + center - x, 0, g_size);
+    fy_start = CLAMP (center - y, 0, g_size);
+    fy_end = CLAMP (height + center - y, 0, g_size);
+
+    if ((fx_end <= fx_start) || (fy_end <= fy_start))
+    {
+        return 0;
+    }
+
+    /* The kernel is separable, the sum over the area is the product of the sums over each axis */
+    v = (guint64) (map->sums[fx_end] - map->sums[fx_start])
+      * (guint64) (map->sums[fy_end] - map->sums[fy_start]);
+    o = (guint64) (CLAMP (opacity, 0.0, 1.0) * 255.0 * GAUSSIAN_ONE);
+
+    return ((guchar) ((v * o) >> (3 * GAUSSIAN_SHIFT)));
+}
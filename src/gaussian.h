@@ -0,0 +1,50 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+        xcompmgr - (c) 2003 Keith Packard
+        xfwm4    - (c) 2005-2015 Olivier Fourdan
+
+ */
+
+#ifndef INC_GAUSSIAN_H
+#define INC_GAUSSIAN_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+
+/* Fixed point precision of the normalized gaussian sums */
+#define GAUSSIAN_SHIFT  16
+#define GAUSSIAN_ONE    (1 << GAUSSIAN_SHIFT)
+
+struct _gaussian_conv {
+    int     size;
+    guint32 *sums;
+};
+typedef struct _gaussian_conv gaussian_conv;
+
+gaussian_conv           *gaussianMapNew                         (gdouble);
+guchar                   gaussianSum                            (gaussian_conv *,
+                                                                 gdouble,
+                                                                 gint,
+                                                                 gint,
+                                                                 gint,
+                                                                 gint);
+
+#endif /* INC_GAUSSIAN_H */
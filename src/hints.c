@@ -41,9 +41,14 @@
 #include <stdlib.h>
 #include <libxfce4util/libxfce4util.h>
 
+#ifdef HAVE_XCB
+#include <X11/Xlib-xcb.h>
+#endif
+
 #include "display.h"
 #include "screen.h"
 #include "hints.h"
+#include "misc.h"
 
 static gboolean
 check_type_and_format (int expected_format, Atom expected_type, int n_items, int format, Atom type)
@@ -75,6 +80,548 @@ internal_utf8_strndup (const gchar *src, gssize max_len)
     return g_strndup (src, s - src);
 }
 
+/* Accounting of the synchronous property fetches, see initPropertyStats() */
+typedef struct _PropertyStats PropertyStats;
+struct _PropertyStats
+{
+    gchar *operation;
+    const gchar *site;
+    Atom atom;
+    guint64 count;
+    gint64 time;
+    gint64 max_time;
+};
+
+static GHashTable *property_stats = NULL;
+static gchar *property_stats_file = NULL;
+static const gchar *property_stats_operation = "other";
+
+static void
+property_stats_free (PropertyStats *stats)
+{
+    g_free (stats->operation);
+    g_free (stats);
+}
+
+static void
+property_stats_record (const gchar *site, Atom atom, gint64 time)
+{
+    PropertyStats *stats;
+    gchar *key;
+
+    key = g_strdup_printf ("%s\t%s\t%lu", property_stats_operation, site, atom);
+    stats = g_hash_table_lookup (property_stats, key);
+    if (stats == NULL)
+    {
+        stats = g_new0 (PropertyStats, 1);
+        stats->operation = g_strdup (property_stats_operation);
+        stats->site = site;
+        stats->atom = atom;
+        /* The hash table owns the key */
+        g_hash_table_insert (property_stats, key, stats);
+    }
+    else
+    {
+        g_free (key);
+    }
+
+    stats->count++;
+    stats->time += time;
+    stats->max_time = MAX (stats->max_time, time);
+}
+
+/* Length in 32 bit units requested for each prefetched or cached property;
+   anything larger is left to a regular, synchronous request */
+#define PREFETCH_MAX_LENGTH 1024
+
+typedef struct _PrefetchedProperty PrefetchedProperty;
+struct _PrefetchedProperty
+{
+    Atom type;
+    int format;
+    unsigned long nitems;
+    unsigned long bytes_after;
+    /* Same layout as returned by XGetWindowProperty() */
+    unsigned char *data;
+};
+
+static void
+prefetched_property_free (PrefetchedProperty *p)
+{
+    g_free (p->data);
+    g_free (p);
+}
+
+static PrefetchedProperty *
+prefetched_property_copy (Atom type, int format, unsigned long nitems, const unsigned char *data)
+{
+    PrefetchedProperty *p;
+
+    p = g_new0 (PrefetchedProperty, 1);
+    p->type = type;
+    p->format = format;
+    p->nitems = nitems;
+
+    switch (format)
+    {
+        case 8:
+            p->data = g_malloc (nitems + 1);
+            memcpy (p->data, data, nitems);
+            p->data[nitems] = '\0';
+            break;
+        case 16:
+            p->data = (unsigned char *) g_new (short, nitems + 1);
+            memcpy (p->data, data, nitems * sizeof (short));
+            break;
+        case 32:
+            p->data = (unsigned char *) g_new (long, nitems + 1);
+            memcpy (p->data, data, nitems * sizeof (long));
+            break;
+        default:
+            p->format = 0;
+            p->nitems = 0;
+            break;
+    }
+
+    return p;
+}
+
+#ifdef HAVE_XCB
+
+static PrefetchedProperty *
+prefetched_property_new (xcb_get_property_reply_t *reply)
+{
+    PrefetchedProperty *p;
+    unsigned long i;
+    int len;
+
+    p = g_new0 (PrefetchedProperty, 1);
+    p->type = (Atom) reply->type;
+    p->format = reply->format;
+    p->bytes_after = reply->bytes_after;
+    len = xcb_get_property_value_length (reply);
+
+    switch (p->format)
+    {
+        case 8:
+            p->nitems = len;
+            p->data = g_malloc (p->nitems + 1);
+            memcpy (p->data, xcb_get_property_value (reply), p->nitems);
+            p->data[p->nitems] = '\0';
+            break;
+        case 16:
+            {
+                uint16_t *src = (uint16_t *) xcb_get_property_value (reply);
+                short *dst;
+
+                p->nitems = len / 2;
+                dst = g_new (short, p->nitems + 1);
+                for (i = 0; i < p->nitems; i++)
+                {
+                    dst[i] = (short) src[i];
+                }
+                p->data = (unsigned char *) dst;
+            }
+            break;
+        case 32:
+            {
+                uint32_t *src = (uint32_t *) xcb_get_property_value (reply);
+                long *dst;
+
+                p->nitems = len / 4;
+                dst = g_new (long, p->nitems + 1);
+                for (i = 0; i < p->nitems; i++)
+                {
+                    dst[i] = (long) src[i];
+                }
+                p->data = (unsigned char *) dst;
+            }
+            break;
+        default:
+            p->format = 0;
+            p->nitems = 0;
+            break;
+    }
+
+    return p;
+}
+
+static PrefetchedProperty *
+lookup_prefetched (DisplayInfo *display_info, Window w, Atom property)
+{
+    GHashTable *props;
+
+    props = g_hash_table_lookup (display_info->prefetched, GUINT_TO_POINTER (w));
+    if (props == NULL)
+    {
+        return NULL;
+    }
+
+    return g_hash_table_lookup (props, GUINT_TO_POINTER (property));
+}
+
+static void
+prefetch_properties (DisplayInfo *display_info, const Window *windows, const Atom *atoms, guint n)
+{
+    xcb_connection_t *conn;
+    xcb_get_property_cookie_t *cookies;
+    xcb_get_property_reply_t *reply;
+    xcb_generic_error_t *error;
+    GHashTable *props;
+    gint64 start;
+    guint i;
+
+    conn = XGetXCBConnection (display_info->dpy);
+    cookies = g_new (xcb_get_property_cookie_t, n);
+
+    /* Send all the requests first... */
+    for (i = 0; i < n; i++)
+    {
+        cookies[i] = xcb_get_property (conn, FALSE, windows[i], atoms[i],
+                                       XCB_GET_PROPERTY_TYPE_ANY, 0,
+                                       PREFETCH_MAX_LENGTH);
+    }
+
+    /* ...then collect the replies, costing a single round trip */
+    start = G_UNLIKELY (property_stats) ? g_get_monotonic_time () : 0;
+    for (i = 0; i < n; i++)
+    {
+        error = NULL;
+        reply = xcb_get_property_reply (conn, cookies[i], &error);
+        if (reply == NULL)
+        {
+            /* Window gone, leave it to the regular code path */
+            free (error);
+            continue;
+        }
+
+        props = g_hash_table_lookup (display_info->prefetched, GUINT_TO_POINTER (windows[i]));
+        if (props == NULL)
+        {
+            props = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                           NULL, (GDestroyNotify) prefetched_property_free);
+            g_hash_table_insert (display_info->prefetched, GUINT_TO_POINTER (windows[i]), props);
+        }
+        g_hash_table_replace (props, GUINT_TO_POINTER (atoms[i]),
+                              prefetched_property_new (reply));
+        free (reply);
+    }
+    if (G_UNLIKELY (property_stats))
+    {
+        property_stats_record ("prefetchClientHints", None, g_get_monotonic_time () - start);
+    }
+
+    g_free (cookies);
+}
+
+#endif /* HAVE_XCB */
+
+static gboolean
+get_prefetched_property (PrefetchedProperty *p, long long_offset, long long_length, Atom req_type,
+                         Atom *actual_type, int *actual_format, unsigned long *nitems,
+                         unsigned long *bytes_after, unsigned char **prop)
+{
+    unsigned long fetched, total, wanted, item_size;
+    unsigned char *data;
+
+    *actual_type = None;
+    *actual_format = 0;
+    *nitems = 0;
+    *bytes_after = 0;
+    *prop = NULL;
+
+    if (p->type == None)
+    {
+        return TRUE;
+    }
+
+    /* Only serve what a regular request would have returned */
+    if ((long_offset != 0) || (p->format == 0))
+    {
+        return FALSE;
+    }
+    item_size = p->format / 8;
+    fetched = p->nitems * item_size;
+    total = fetched + p->bytes_after;
+    if ((unsigned long) long_length >= (total + 3) / 4)
+    {
+        wanted = total;
+    }
+    else
+    {
+        wanted = (unsigned long) long_length * 4;
+    }
+    if (wanted > fetched)
+    {
+        return FALSE;
+    }
+
+    *actual_type = p->type;
+    *actual_format = p->format;
+
+    if ((req_type != AnyPropertyType) && (req_type != p->type))
+    {
+        *bytes_after = total;
+        return TRUE;
+    }
+
+    *nitems = wanted / item_size;
+    *bytes_after = total - *nitems * item_size;
+
+    /* Callers release the data with XFree() */
+    switch (p->format)
+    {
+        case 8:
+            data = malloc (*nitems + 1);
+            memcpy (data, p->data, *nitems);
+            data[*nitems] = '\0';
+            break;
+        case 16:
+            data = malloc ((*nitems + 1) * sizeof (short));
+            memcpy (data, p->data, *nitems * sizeof (short));
+            break;
+        case 32:
+            data = malloc ((*nitems + 1) * sizeof (long));
+            memcpy (data, p->data, *nitems * sizeof (long));
+            break;
+        default:
+            data = NULL;
+            break;
+    }
+    *prop = data;
+
+    return TRUE;
+}
+
+static int
+fetch_window_property (const gchar *site, DisplayInfo *display_info, Window w, Atom property,
+                       long long_offset, long long_length, Atom req_type,
+                       Atom *actual_type, int *actual_format, unsigned long *nitems,
+                       unsigned long *bytes_after, unsigned char **prop)
+{
+    gint64 start;
+    int result;
+
+    if (G_LIKELY (property_stats == NULL))
+    {
+        return XGetWindowProperty (display_info->dpy, w, property, long_offset, long_length,
+                                   FALSE, req_type, actual_type, actual_format, nitems,
+                                   bytes_after, prop);
+    }
+
+    start = g_get_monotonic_time ();
+    result = XGetWindowProperty (display_info->dpy, w, property, long_offset, long_length,
+                                 FALSE, req_type, actual_type, actual_format, nitems,
+                                 bytes_after, prop);
+    property_stats_record (site, property, g_get_monotonic_time () - start);
+
+    return result;
+}
+
+/* Properties that clients set once and for all; their values are kept
+   while the window is managed and dropped when a PropertyNotify reports
+   a change */
+static gboolean
+is_cached_property (DisplayInfo *display_info, Atom property)
+{
+    return ((property == XA_WM_CLASS) ||
+            (property == display_info->atoms[WM_CLIENT_MACHINE]) ||
+            (property == display_info->atoms[WM_CLIENT_LEADER]) ||
+            (property == display_info->atoms[WM_WINDOW_ROLE]) ||
+            (property == display_info->atoms[NET_WM_PID]) ||
+            (property == display_info->atoms[SM_CLIENT_ID]) ||
+            (property == display_info->atoms[CONTAINER]) ||
+            (property == display_info->atoms[FIREJAIL_SANDBOX_TYPE]) ||
+            (property == display_info->atoms[FIREJAIL_SANDBOX_NAME]) ||
+            (property == display_info->atoms[FIREJAIL_SANDBOX_WORKSPACE]));
+}
+
+static PrefetchedProperty *
+get_cached_property (const gchar *site, DisplayInfo *display_info, Window w, Atom property)
+{
+    GHashTable *props;
+    PrefetchedProperty *p;
+    Atom type;
+    int format;
+    unsigned long nitems, bytes_after;
+    unsigned char *data;
+
+    if (!is_cached_property (display_info, property))
+    {
+        return NULL;
+    }
+
+    /* Only windows we get PropertyNotify for are cached, see watchCachedHints() */
+    props = g_hash_table_lookup (display_info->property_cache, GUINT_TO_POINTER (w));
+    if (props == NULL)
+    {
+        return NULL;
+    }
+
+    p = g_hash_table_lookup (props, GUINT_TO_POINTER (property));
+    if (p)
+    {
+        return p;
+    }
+
+#ifdef HAVE_XCB
+    p = lookup_prefetched (display_info, w, property);
+    if ((p) && (p->bytes_after == 0))
+    {
+        p = prefetched_property_copy (p->type, p->format, p->nitems, p->data);
+        g_hash_table_insert (props, GUINT_TO_POINTER (property), p);
+        return p;
+    }
+#endif /* HAVE_XCB */
+
+    /* Fetch the whole value once, whatever the caller asked for */
+    data = NULL;
+    if ((fetch_window_property (site, display_info, w, property, 0L, PREFETCH_MAX_LENGTH,
+                                AnyPropertyType, &type, &format, &nitems, &bytes_after,
+                                &data) != Success) || (bytes_after != 0))
+    {
+        if (data)
+        {
+            XFree (data);
+        }
+        return NULL;
+    }
+
+    p = prefetched_property_copy (type, format, nitems, data);
+    g_hash_table_insert (props, GUINT_TO_POINTER (property), p);
+    if (data)
+    {
+        XFree (data);
+    }
+
+    return p;
+}
+
+/* The property getters below pass their own name along, for the accounting */
+#define get_window_property(display_info, ...) \
+    get_window_property_at (G_STRFUNC, display_info, __VA_ARGS__)
+#define get_xtext_property(display_info, ...) \
+    get_xtext_property_at (G_STRFUNC, display_info, __VA_ARGS__)
+#define get_wm_protocols(display_info, ...) \
+    get_wm_protocols_at (G_STRFUNC, display_info, __VA_ARGS__)
+#define get_transient_for_hint(display_info, ...) \
+    get_transient_for_hint_at (G_STRFUNC, display_info, __VA_ARGS__)
+
+static int
+get_window_property_at (const gchar *site, DisplayInfo *display_info, Window w, Atom property,
+                        long long_offset, long long_length, Atom req_type,
+                        Atom *actual_type, int *actual_format, unsigned long *nitems,
+                        unsigned long *bytes_after, unsigned char **prop)
+{
+    PrefetchedProperty *p;
+
+    p = get_cached_property (site, display_info, w, property);
+#ifdef HAVE_XCB
+    if (p == NULL)
+    {
+        p = lookup_prefetched (display_info, w, property);
+    }
+#endif /* HAVE_XCB */
+    if ((p) && get_prefetched_property (p, long_offset, long_length, req_type,
+                                        actual_type, actual_format, nitems,
+                                        bytes_after, prop))
+    {
+        return Success;
+    }
+
+    return fetch_window_property (site, display_info, w, property, long_offset, long_length,
+                                  req_type, actual_type, actual_format, nitems,
+                                  bytes_after, prop);
+}
+
+static Status
+get_xtext_property_at (const gchar *site, DisplayInfo *display_info, Window w,
+                       XTextProperty *tp, Atom property)
+{
+    Atom actual_type;
+    int actual_format;
+    unsigned long nitems;
+    unsigned long bytes_after;
+    unsigned char *data;
+
+    data = NULL;
+    if ((get_window_property_at (site, display_info, w, property, 0L, 1000000L, AnyPropertyType,
+                                 &actual_type, &actual_format, &nitems, &bytes_after,
+                                 &data) == Success) && (actual_type != None))
+    {
+        tp->encoding = actual_type;
+        tp->format = actual_format;
+        tp->nitems = nitems;
+        tp->value = data;
+        return True;
+    }
+
+    tp->encoding = None;
+    tp->format = 0;
+    tp->nitems = 0;
+    tp->value = NULL;
+
+    return False;
+}
+
+static Status
+get_wm_protocols_at (const gchar *site, DisplayInfo *display_info, Window w,
+                     Atom **protocols, int *count)
+{
+    Atom actual_type;
+    int actual_format;
+    unsigned long nitems;
+    unsigned long bytes_after;
+    unsigned char *data;
+
+    data = NULL;
+    if ((get_window_property_at (site, display_info, w, display_info->atoms[WM_PROTOCOLS],
+                                 0L, 1000000L, XA_ATOM, &actual_type, &actual_format,
+                                 &nitems, &bytes_after, &data) != Success)
+        || (actual_type != XA_ATOM) || (actual_format != 32))
+    {
+        if (data)
+        {
+            XFree (data);
+        }
+        return False;
+    }
+
+    *protocols = (Atom *) data;
+    *count = (int) nitems;
+
+    return True;
+}
+
+static Status
+get_transient_for_hint_at (const gchar *site, DisplayInfo *display_info, Window w,
+                           Window *transient_for)
+{
+    Atom actual_type;
+    int actual_format;
+    unsigned long nitems;
+    unsigned long bytes_after;
+    unsigned char *data;
+
+    data = NULL;
+    *transient_for = None;
+    if ((get_window_property_at (site, display_info, w, XA_WM_TRANSIENT_FOR,
+                                 0L, 1L, XA_WINDOW, &actual_type, &actual_format,
+                                 &nitems, &bytes_after, &data) == Success)
+        && (actual_type == XA_WINDOW) && (actual_format == 32) && (nitems != 0))
+    {
+        *transient_for = *((Window *) data);
+        XFree (data);
+        return True;
+    }
+    if (data)
+    {
+        XFree (data);
+    }
+
+    return False;
+}
+
 unsigned long
 getWMState (DisplayInfo *display_info, Window w)
 {
@@ -88,10 +635,10 @@ getWMState (DisplayInfo *display_info, Window w)
 
     data = NULL;
     state = WithdrawnState;
-    if ((XGetWindowProperty (display_info->dpy, w, display_info->atoms[WM_STATE],
-                             0, 3L, FALSE, display_info->atoms[WM_STATE],
-                             &real_type, &real_format, &items_read, &items_left,
-                             (unsigned char **) &data) == Success) && (items_read))
+    if ((get_window_property (display_info, w, display_info->atoms[WM_STATE],
+                              0, 3L, display_info->atoms[WM_STATE],
+                              &real_type, &real_format, &items_read, &items_left,
+                              (unsigned char **) &data) == Success) && (items_read))
     {
         state = *data;
         if (data)
@@ -130,8 +677,8 @@ getMotifHints (DisplayInfo *display_info, Window w)
 
     data = NULL;
     result = NULL;
-    if ((XGetWindowProperty (display_info->dpy, w, display_info->atoms[MOTIF_WM_HINTS], 0L, MWM_HINTS_ELEMENTS,
-                FALSE, display_info->atoms[MOTIF_WM_HINTS], &real_type, &real_format, &items_read,
+    if ((get_window_property (display_info, w, display_info->atoms[MOTIF_WM_HINTS], 0L, MWM_HINTS_ELEMENTS,
+                display_info->atoms[MOTIF_WM_HINTS], &real_type, &real_format, &items_read,
                 &items_left, (unsigned char **) &data) == Success))
     {
         if (items_read >= MWM_HINTS_ELEMENTS)
@@ -161,7 +708,7 @@ getWMProtocols (DisplayInfo *display_info, Window w)
     TRACE ("entering getWMProtocols");
 
     result = 0;
-    if (XGetWMProtocols (display_info->dpy, w, &protocols, &n))
+    if (get_wm_protocols (display_info, w, &protocols, &n))
     {
         for (i = 0, ap = protocols; i < n; i++, ap++)
         {
@@ -191,8 +738,8 @@ getWMProtocols (DisplayInfo *display_info, Window w)
     }
     else
     {
-        if ((XGetWindowProperty (display_info->dpy, w,
-                    display_info->atoms[WM_PROTOCOLS], 0L, 10L, FALSE,
+        if ((get_window_property (display_info, w,
+                    display_info->atoms[WM_PROTOCOLS], 0L, 10L,
                     display_info->atoms[WM_PROTOCOLS], &atype,
                     &aformat, &nitems, &bytes_remain,
                     (unsigned char **) &data)) == Success)
@@ -238,9 +785,9 @@ getHint (DisplayInfo *display_info, Window w, int atom_id, long *value)
     *value = 0;
     data = NULL;
 
-    if ((XGetWindowProperty (display_info->dpy, w, display_info->atoms[atom_id], 0L, 1L,
-                             FALSE, XA_CARDINAL, &real_type, &real_format, &items_read, &items_left,
-                             (unsigned char **) &data) == Success) && (items_read))
+    if ((get_window_property (display_info, w, display_info->atoms[atom_id], 0L, 1L,
+                              XA_CARDINAL, &real_type, &real_format, &items_read, &items_left,
+                              (unsigned char **) &data) == Success) && (items_read))
     {
         *value = *((long *) data) & ((1LL << real_format) - 1);
         if (data)
@@ -279,8 +826,8 @@ getDesktopLayout (DisplayInfo *display_info, Window root, int ws_count, NetWmDes
     data = NULL;
     success = FALSE;
 
-    if ((XGetWindowProperty (display_info->dpy, root, display_info->atoms[NET_DESKTOP_LAYOUT],
-                0L, 4L, FALSE, XA_CARDINAL,
+    if ((get_window_property (display_info, root, display_info->atoms[NET_DESKTOP_LAYOUT],
+                0L, 4L, XA_CARDINAL,
                 &real_type, &real_format, &items_read, &items_left,
                 (unsigned char **) &data) == Success) && (items_read >= 3))
     {
@@ -453,9 +1000,9 @@ getAtomList (DisplayInfo *display_info, Window w, int atom_id, Atom ** atoms_p,
     g_return_val_if_fail (((atom_id >= 0) && (atom_id < ATOM_COUNT)), FALSE);
     TRACE ("entering getAtomList()");
 
-    if ((XGetWindowProperty (display_info->dpy, w, display_info->atoms[atom_id],
-                             0, G_MAXLONG, FALSE, XA_ATOM, &type, &format, &n_atoms,
-                             &bytes_after, (unsigned char **) &data) != Success) || (type == None))
+    if ((get_window_property (display_info, w, display_info->atoms[atom_id],
+                              0, G_MAXLONG, XA_ATOM, &type, &format, &n_atoms,
+                              &bytes_after, (unsigned char **) &data) != Success) || (type == None))
     {
         return FALSE;
     }
@@ -494,10 +1041,10 @@ getCardinalList (DisplayInfo *display_info, Window w, int atom_id, unsigned long
     g_return_val_if_fail (((atom_id >= 0) && (atom_id < ATOM_COUNT)), FALSE);
     TRACE ("entering getCardinalList()");
 
-    if ((XGetWindowProperty (display_info->dpy, w, display_info->atoms[atom_id],
-                             0, G_MAXLONG, FALSE, XA_CARDINAL,
-                             &type, &format, &n_cardinals, &bytes_after,
-                             (unsigned char **) &data) != Success) || (type == None))
+    if ((get_window_property (display_info, w, display_info->atoms[atom_id],
+                              0, G_MAXLONG, XA_CARDINAL,
+                              &type, &format, &n_cardinals, &bytes_after,
+                              (unsigned char **) &data) != Success) || (type == None))
     {
         return FALSE;
     }
@@ -621,7 +1168,7 @@ getTransientFor (DisplayInfo *display_info, Window root, Window w, Window * tran
 {
     TRACE ("entering getTransientFor");
 
-    if (XGetTransientForHint (display_info->dpy, w, transient_for))
+    if (get_transient_for_hint (display_info, w, transient_for))
     {
         if (*transient_for == None)
         {
@@ -674,7 +1221,7 @@ get_text_property (DisplayInfo *display_info, Window w, Atom a)
 
     TRACE ("entering get_text_property");
     text.nitems = 0;
-    if (XGetTextProperty (display_info->dpy, w, &text, a))
+    if (get_xtext_property (display_info, w, &text, a))
     {
         retval = text_property_to_utf8 (display_info, &text);
         if (retval)
@@ -709,9 +1256,9 @@ getUTF8StringData (DisplayInfo *display_info, Window w, int atom_id, gchar **str
     TRACE ("entering getUTF8StringData");
 
     *str_p = NULL;
-    if ((XGetWindowProperty (display_info->dpy, w, display_info->atoms[atom_id],
-                             0, G_MAXLONG, FALSE, display_info->atoms[UTF8_STRING], &type,
-                             &format, &n_items, &bytes_after, (unsigned char **) &str) != Success) || (type == None))
+    if ((get_window_property (display_info, w, display_info->atoms[atom_id],
+                              0, G_MAXLONG, display_info->atoms[UTF8_STRING], &type,
+                              &format, &n_items, &bytes_after, (unsigned char **) &str) != Success) || (type == None))
     {
         TRACE ("no UTF8_STRING property found");
         return FALSE;
@@ -843,9 +1390,9 @@ getWindowProp (DisplayInfo *display_info, Window window, int atom_id, Window *w)
     g_return_val_if_fail (((atom_id >= 0) && (atom_id < ATOM_COUNT)), FALSE);
 
     *w = None;
-    if (XGetWindowProperty (display_info->dpy, window, display_info->atoms[atom_id],
-                            0L, 1L, FALSE, XA_WINDOW, &type, &format, &nitems,
-                            &bytes_after, (unsigned char **) &prop) == Success)
+    if (get_window_property (display_info, window, display_info->atoms[atom_id],
+                             0L, 1L, XA_WINDOW, &type, &format, &nitems,
+                             &bytes_after, (unsigned char **) &prop) == Success)
     {
         if (prop)
         {
@@ -930,7 +1477,7 @@ getWindowRole (DisplayInfo *display_info, Window window, gchar **role)
     *role = NULL;
     g_return_val_if_fail (window != None, FALSE);
 
-    if (XGetTextProperty (display_info->dpy, window, &tp, display_info->atoms[WM_WINDOW_ROLE]))
+    if (get_xtext_property (display_info, window, &tp, display_info->atoms[WM_WINDOW_ROLE]))
     {
         if (tp.value)
         {
@@ -947,6 +1494,45 @@ getWindowRole (DisplayInfo *display_info, Window window, gchar **role)
     return FALSE;
 }
 
+gboolean
+getClassHint (DisplayInfo *display_info, Window w, XClassHint *class_hint)
+{
+    Atom actual_type;
+    int actual_format;
+    unsigned long nitems;
+    unsigned long bytes_after;
+    unsigned char *data;
+    size_t len;
+
+    TRACE ("entering getClassHint");
+
+    g_return_val_if_fail (class_hint != NULL, FALSE);
+    class_hint->res_name = NULL;
+    class_hint->res_class = NULL;
+    g_return_val_if_fail (w != None, FALSE);
+
+    data = NULL;
+    if ((get_window_property (display_info, w, XA_WM_CLASS, 0L, (long) PREFETCH_MAX_LENGTH,
+                              XA_STRING, &actual_type, &actual_format, &nitems,
+                              &bytes_after, &data) != Success)
+        || (actual_type != XA_STRING) || (actual_format != 8) || (data == NULL))
+    {
+        if (data)
+        {
+            XFree (data);
+        }
+        return FALSE;
+    }
+
+    /* Two consecutive nul terminated strings, released with XFree() like XGetClassHint() */
+    len = strlen ((char *) data);
+    class_hint->res_name = strdup ((char *) data);
+    class_hint->res_class = strdup ((len + 1 < nitems) ? (char *) data + len + 1 : "");
+    XFree (data);
+
+    return TRUE;
+}
+
 Window
 getClientLeader (DisplayInfo *display_info, Window window)
 {
@@ -973,9 +1559,9 @@ getNetWMUserTime (DisplayInfo *display_info, Window window, guint32 *timestamp)
 
     g_return_val_if_fail (window != None, FALSE);
 
-    if (XGetWindowProperty (display_info->dpy, window, display_info->atoms[NET_WM_USER_TIME],
-                            0L, 1L, FALSE, XA_CARDINAL, &actual_type, &actual_format, &nitems,
-                            &bytes_after, (unsigned char **) &data) == Success)
+    if (get_window_property (display_info, window, display_info->atoms[NET_WM_USER_TIME],
+                             0L, 1L, XA_CARDINAL, &actual_type, &actual_format, &nitems,
+                             &bytes_after, (unsigned char **) &data) == Success)
     {
         if ((data) && (actual_type == XA_CARDINAL)
             && (nitems == 1) && (bytes_after == 0))
@@ -1020,7 +1606,7 @@ getClientID (DisplayInfo *display_info, Window window, gchar **client_id)
 
     if (getWindowProp (display_info, window, WM_CLIENT_LEADER, &id) && (id != None))
     {
-        if (XGetTextProperty (display_info->dpy, id, &tp, display_info->atoms[SM_CLIENT_ID]))
+        if (get_xtext_property (display_info, id, &tp, display_info->atoms[SM_CLIENT_ID]))
         {
             if (tp.encoding == XA_STRING && tp.format == 8 && tp.nitems != 0)
             {
@@ -1048,7 +1634,7 @@ getContainerName (DisplayInfo *display_info, Window window, gchar **container_na
 
     if (getWindowProp (display_info, window, WM_CLIENT_LEADER, &id) && (id != None))
     {
-        if (XGetTextProperty (display_info->dpy, id, &tp, display_info->atoms[CONTAINER]))
+        if (get_xtext_property (display_info, id, &tp, display_info->atoms[CONTAINER]))
         {
             if (tp.encoding == XA_STRING && tp.format == 8 && tp.nitems != 0)
             {
@@ -1076,7 +1662,7 @@ getSandboxType (DisplayInfo *display_info, Window window, gchar **sandbox_type)
 
     if (getWindowProp (display_info, window, WM_CLIENT_LEADER, &id) && (id != None))
     {
-        if (XGetTextProperty (display_info->dpy, id, &tp, display_info->atoms[FIREJAIL_SANDBOX_TYPE]))
+        if (get_xtext_property (display_info, id, &tp, display_info->atoms[FIREJAIL_SANDBOX_TYPE]))
         {
             if (tp.encoding == XA_STRING && tp.format == 8 && tp.nitems != 0)
             {
@@ -1104,7 +1690,7 @@ getSandboxName (DisplayInfo *display_info, Window window, gchar **sandbox_name)
 
     if (getWindowProp (display_info, window, WM_CLIENT_LEADER, &id) && (id != None))
     {
-        if (XGetTextProperty (display_info->dpy, id, &tp, display_info->atoms[FIREJAIL_SANDBOX_NAME]))
+        if (get_xtext_property (display_info, id, &tp, display_info->atoms[FIREJAIL_SANDBOX_NAME]))
         {
             if (tp.encoding == XA_STRING && tp.format == 8 && tp.nitems != 0)
             {
@@ -1132,7 +1718,7 @@ getSandboxWorkspace (DisplayInfo *display_info, Window window, gchar **sandbox_w
 
     if (getWindowProp (display_info, window, WM_CLIENT_LEADER, &id) && (id != None))
     {
-        if (XGetTextProperty (display_info->dpy, id, &tp, display_info->atoms[FIREJAIL_SANDBOX_WORKSPACE]))
+        if (get_xtext_property (display_info, id, &tp, display_info->atoms[FIREJAIL_SANDBOX_WORKSPACE]))
         {
             if (tp.encoding == XA_STRING && tp.format == 8 && tp.nitems != 0)
             {
@@ -1182,9 +1768,9 @@ getKDEIcon (DisplayInfo *display_info, Window window, Pixmap * pixmap, Pixmap *
     *mask = None;
 
     icons = NULL;
-    if (XGetWindowProperty (display_info->dpy, window, display_info->atoms[KWM_WIN_ICON],
-                            0L, G_MAXLONG, FALSE, display_info->atoms[KWM_WIN_ICON], &type,
-                            &format, &nitems, &bytes_after, (unsigned char **)&data) != Success)
+    if (get_window_property (display_info, window, display_info->atoms[KWM_WIN_ICON],
+                             0L, G_MAXLONG, display_info->atoms[KWM_WIN_ICON], &type,
+                             &format, &nitems, &bytes_after, (unsigned char **)&data) != Success)
     {
         return FALSE;
     }
@@ -1213,9 +1799,9 @@ getRGBIconData (DisplayInfo *display_info, Window window, unsigned long **data,
     int format;
     unsigned long bytes_after;
 
-    if (XGetWindowProperty (display_info->dpy, window, display_info->atoms[NET_WM_ICON],
-                            0L, G_MAXLONG, FALSE, XA_CARDINAL, &type, &format, nitems,
-                            &bytes_after, (unsigned char **) data) != Success)
+    if (get_window_property (display_info, window, display_info->atoms[NET_WM_ICON],
+                             0L, G_MAXLONG, XA_CARDINAL, &type, &format, nitems,
+                             &bytes_after, (unsigned char **) data) != Success)
     {
         *data = NULL;
         return FALSE;
@@ -1361,9 +1947,9 @@ checkKdeSystrayWindow (DisplayInfo *display_info, Window window)
     TRACE ("entering checkKdeSystrayWindow");
     g_return_val_if_fail (window != None, FALSE);
 
-    XGetWindowProperty(display_info->dpy, window, display_info->atoms[KDE_NET_WM_SYSTEM_TRAY_WINDOW_FOR],
-                       0L, sizeof(Window), FALSE, XA_WINDOW, &actual_type, &actual_format,
-                       &nitems, &bytes_after, (unsigned char **) &data);
+    get_window_property (display_info, window, display_info->atoms[KDE_NET_WM_SYSTEM_TRAY_WINDOW_FOR],
+                        0L, sizeof(Window), XA_WINDOW, &actual_type, &actual_format,
+                        &nitems, &bytes_after, (unsigned char **) &data);
 
     trayIconForWindow = None;
     if (data)
@@ -1452,3 +2038,285 @@ getWindowStartupId (DisplayInfo *display_info, Window w, gchar **startup_id)
     return FALSE;
 }
 #endif
+
+#ifdef HAVE_XCB
+static void
+prefetch_append (GArray *windows, GArray *atoms, Window w, Atom atom)
+{
+    g_array_append_val (windows, w);
+    g_array_append_val (atoms, atom);
+}
+
+static void
+prefetch_client_hints (DisplayInfo *display_info, const Window *clients, guint n_clients)
+{
+    static const int client_atoms[] = {
+        NET_WM_NAME,
+        WM_CLIENT_MACHINE,
+        WM_WINDOW_ROLE,
+        MOTIF_WM_HINTS,
+        WM_PROTOCOLS,
+        WM_CLIENT_LEADER,
+        NET_WM_USER_TIME_WINDOW,
+        NET_WM_USER_TIME,
+        NET_WM_PID,
+        NET_WM_WINDOW_OPACITY,
+        NET_WM_WINDOW_OPACITY_LOCKED,
+        NET_WM_STATE,
+        NET_WM_WINDOW_TYPE,
+        NET_WM_DESKTOP,
+        NET_WM_STRUT_PARTIAL,
+        NET_WM_STRUT,
+        GTK_FRAME_EXTENTS,
+        GTK_HIDE_TITLEBAR_WHEN_MAXIMIZED,
+        NET_STARTUP_ID
+    };
+    static const int leader_atoms[] = {
+        SM_CLIENT_ID,
+        CONTAINER,
+        FIREJAIL_SANDBOX_TYPE,
+        FIREJAIL_SANDBOX_NAME,
+        FIREJAIL_SANDBOX_WORKSPACE
+    };
+    GArray *windows, *atoms;
+    GHashTable *leaders;
+    Window w, leader, user_time_win;
+    PrefetchedProperty *p;
+    guint i, j;
+
+    windows = g_array_sized_new (FALSE, FALSE, sizeof (Window),
+                                 n_clients * (G_N_ELEMENTS (client_atoms) + 3));
+    atoms = g_array_sized_new (FALSE, FALSE, sizeof (Atom),
+                               n_clients * (G_N_ELEMENTS (client_atoms) + 3));
+
+    /* First batch, the properties of the client windows themselves */
+    for (i = 0; i < n_clients; i++)
+    {
+        w = clients[i];
+        for (j = 0; j < G_N_ELEMENTS (client_atoms); j++)
+        {
+            prefetch_append (windows, atoms, w, display_info->atoms[client_atoms[j]]);
+        }
+        prefetch_append (windows, atoms, w, XA_WM_NAME);
+        prefetch_append (windows, atoms, w, XA_WM_CLASS);
+        prefetch_append (windows, atoms, w, XA_WM_TRANSIENT_FOR);
+    }
+    prefetch_properties (display_info, (Window *) windows->data, (Atom *) atoms->data, windows->len);
+
+    /* Second batch, the properties found on the windows the first one points to */
+    g_array_set_size (windows, 0);
+    g_array_set_size (atoms, 0);
+    leaders = g_hash_table_new (g_direct_hash, g_direct_equal);
+    for (i = 0; i < n_clients; i++)
+    {
+        w = clients[i];
+        p = lookup_prefetched (display_info, w, display_info->atoms[WM_CLIENT_LEADER]);
+        if ((p) && (p->type == XA_WINDOW) && (p->format == 32) && (p->nitems > 0))
+        {
+            leader = *((Window *) p->data);
+            /* Applications usually share one leader among all their windows */
+            if ((leader != None) && !g_hash_table_contains (leaders, GUINT_TO_POINTER (leader)))
+            {
+                g_hash_table_add (leaders, GUINT_TO_POINTER (leader));
+                for (j = 0; j < G_N_ELEMENTS (leader_atoms); j++)
+                {
+                    prefetch_append (windows, atoms, leader, display_info->atoms[leader_atoms[j]]);
+                }
+            }
+        }
+        p = lookup_prefetched (display_info, w, display_info->atoms[NET_WM_USER_TIME_WINDOW]);
+        if ((p) && (p->type == XA_WINDOW) && (p->format == 32) && (p->nitems > 0))
+        {
+            user_time_win = *((Window *) p->data);
+            if ((user_time_win != None) && (user_time_win != w))
+            {
+                prefetch_append (windows, atoms, user_time_win, display_info->atoms[NET_WM_USER_TIME]);
+            }
+        }
+    }
+    if (windows->len > 0)
+    {
+        prefetch_properties (display_info, (Window *) windows->data, (Atom *) atoms->data, windows->len);
+    }
+
+    g_hash_table_destroy (leaders);
+    g_array_free (windows, TRUE);
+    g_array_free (atoms, TRUE);
+}
+#endif /* HAVE_XCB */
+
+gboolean
+prefetchClientHints (DisplayInfo *display_info, Window w)
+{
+#ifdef HAVE_XCB
+    g_return_val_if_fail (display_info != NULL, FALSE);
+    g_return_val_if_fail (w != None, FALSE);
+    TRACE ("entering prefetchClientHints");
+
+    /* Already part of a batch, see prefetchAllClientHints() */
+    if (g_hash_table_contains (display_info->prefetched, GUINT_TO_POINTER (w)))
+    {
+        return FALSE;
+    }
+    prefetch_client_hints (display_info, &w, 1);
+
+    return TRUE;
+#else  /* HAVE_XCB */
+    return FALSE;
+#endif /* HAVE_XCB */
+}
+
+void
+prefetchAllClientHints (DisplayInfo *display_info, const Window *windows, guint count)
+{
+#ifdef HAVE_XCB
+    g_return_if_fail (display_info != NULL);
+    TRACE ("entering prefetchAllClientHints");
+
+    if (count > 0)
+    {
+        prefetch_client_hints (display_info, windows, count);
+    }
+#endif /* HAVE_XCB */
+}
+
+void
+releasePrefetchedHints (DisplayInfo *display_info, Window w)
+{
+#ifdef HAVE_XCB
+    g_return_if_fail (display_info != NULL);
+    TRACE ("entering releasePrefetchedHints");
+
+    if (w == None)
+    {
+        g_hash_table_remove_all (display_info->prefetched);
+    }
+    else
+    {
+        g_hash_table_remove (display_info->prefetched, GUINT_TO_POINTER (w));
+    }
+#endif /* HAVE_XCB */
+}
+
+gboolean
+watchCachedHints (DisplayInfo *display_info, Window w)
+{
+    g_return_val_if_fail (display_info != NULL, FALSE);
+    g_return_val_if_fail (w != None, FALSE);
+    TRACE ("entering watchCachedHints (0x%lx)", w);
+
+    if (g_hash_table_contains (display_info->property_cache, GUINT_TO_POINTER (w)))
+    {
+        return FALSE;
+    }
+    g_hash_table_insert (display_info->property_cache, GUINT_TO_POINTER (w),
+                         g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                                NULL, (GDestroyNotify) prefetched_property_free));
+
+    return TRUE;
+}
+
+void
+invalidateCachedHint (DisplayInfo *display_info, Window w, Atom property)
+{
+    GHashTable *props;
+
+    g_return_if_fail (display_info != NULL);
+
+    props = g_hash_table_lookup (display_info->property_cache, GUINT_TO_POINTER (w));
+    if (props)
+    {
+        g_hash_table_remove (props, GUINT_TO_POINTER (property));
+    }
+}
+
+void
+forgetCachedHints (DisplayInfo *display_info, Window w)
+{
+    g_return_if_fail (display_info != NULL);
+
+    g_hash_table_remove (display_info->property_cache, GUINT_TO_POINTER (w));
+}
+
+void
+initPropertyStats (DisplayInfo *display_info, const gchar *filename)
+{
+    g_return_if_fail (display_info != NULL);
+    g_return_if_fail (filename != NULL);
+    TRACE ("entering initPropertyStats");
+
+    g_free (property_stats_file);
+    property_stats_file = g_strdup (filename);
+    if (property_stats == NULL)
+    {
+        property_stats = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                                (GDestroyNotify) property_stats_free);
+    }
+}
+
+const gchar *
+setPropertyStatsOperation (const gchar *operation)
+{
+    const gchar *previous;
+
+    previous = property_stats_operation;
+    property_stats_operation = operation;
+
+    return previous;
+}
+
+void
+dumpPropertyStats (DisplayInfo *display_info)
+{
+    PropertyStats *stats;
+    GHashTableIter iter;
+    GString *str;
+    GError *error;
+    gchar *atom_name;
+    guint64 total_count;
+    gint64 total_time;
+    gboolean first;
+
+    g_return_if_fail (display_info != NULL);
+
+    if (property_stats == NULL)
+    {
+        return;
+    }
+    TRACE ("entering dumpPropertyStats");
+
+    str = g_string_new ("{\n  \"fetches\": [");
+    total_count = 0;
+    total_time = 0;
+    first = TRUE;
+
+    g_hash_table_iter_init (&iter, property_stats);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &stats))
+    {
+        atom_name = get_atom_name (display_info, stats->atom);
+        g_string_append_printf (str, "%s\n    { \"operation\": ", first ? "" : ",");
+        appendJsonString (str, stats->operation);
+        g_string_append (str, ", \"site\": ");
+        appendJsonString (str, stats->site);
+        g_string_append (str, ", \"atom\": ");
+        appendJsonString (str, atom_name);
+        g_string_append_printf (str, ", \"count\": %" G_GUINT64_FORMAT ", \"usec\": %" G_GINT64_FORMAT
+                                ", \"max_usec\": %" G_GINT64_FORMAT " }",
+                                stats->count, stats->time, stats->max_time);
+        g_free (atom_name);
+        total_count += stats->count;
+        total_time += stats->time;
+        first = FALSE;
+    }
+    g_string_append_printf (str, "\n  ],\n  \"total_round_trips\": %" G_GUINT64_FORMAT
+                            ",\n  \"total_usec\": %" G_GINT64_FORMAT "\n}\n",
+                            total_count, total_time);
+
+    error = NULL;
+    if (!g_file_set_contents (property_stats_file, str->str, str->len, &error))
+    {
+        g_warning ("Cannot write property statistics: %s", error->message);
+        g_error_free (error);
+    }
+    g_string_free (str, TRUE);
+}
@@ -241,6 +241,9 @@ gboolean                 getWindowHostname                      (DisplayInfo *,
 gboolean                 getWindowRole                          (DisplayInfo *,
                                                                  Window,
                                                                  gchar **);
+gboolean                 getClassHint                           (DisplayInfo *,
+                                                                 Window,
+                                                                 XClassHint *);
 Window                   getClientLeader                        (DisplayInfo *,
                                                                  Window);
 gboolean                 getNetWMUserTime                       (DisplayInfo *,
@@ -305,5 +308,23 @@ gboolean                 getWindowStartupId                     (DisplayInfo *,
                                                                  Window,
                                                                  char **);
 #endif
+gboolean                 prefetchClientHints                    (DisplayInfo *,
+                                                                 Window);
+void                     prefetchAllClientHints                 (DisplayInfo *,
+                                                                 const Window *,
+                                                                 guint);
+void                     releasePrefetchedHints                 (DisplayInfo *,
+                                                                 Window);
+gboolean                 watchCachedHints                       (DisplayInfo *,
+                                                                 Window);
+void                     invalidateCachedHint                   (DisplayInfo *,
+                                                                 Window,
+                                                                 Atom);
+void                     forgetCachedHints                      (DisplayInfo *,
+                                                                 Window);
+void                     initPropertyStats                      (DisplayInfo *,
+                                                                 const gchar *);
+const gchar             *setPropertyStatsOperation              (const gchar *);
+void                     dumpPropertyStats                      (DisplayInfo *);
 
 #endif /* INC_HINTS_H */
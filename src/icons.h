@@ -39,8 +39,5 @@ GdkPixbuf               *getAppIcon                             (ScreenInfo *,
                                                                  Window,
                                                                  guint,
                                                                  guint);
-GdkPixbuf               *getClientIcon                          (Client *,
-                                                                 guint,
-                                                                 guint);
 
 #endif /* INC_ICONS_H */
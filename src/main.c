@@ -52,6 +52,7 @@
 #include "events.h"
 #include "event_filter.h"
 #include "frame.h"
+#include "hints.h"
 #include "settings.h"
 #include "client.h"
 #include "menu.h"
@@ -59,6 +60,7 @@
 #include "keyboard.h"
 #include "workspaces.h"
 #include "mywindow.h"
+#include "sandbox.h"
 #include "session.h"
 #include "startup_notification.h"
 #include "compositor.h"
@@ -101,6 +103,8 @@ static char revision[]="@(#)$ " PACKAGE " version " VERSION " revision " REVISIO
 
 static DisplayInfo *main_display_info = NULL;
 static gint compositor = COMPOSITOR_MODE_MANUAL;
+static gchar *event_stats_file = NULL;
+static gchar *property_stats_file = NULL;
 
 #ifdef DEBUG
 static gboolean
@@ -157,10 +161,11 @@ handleSignal (int sig)
                 main_display_info->quit = TRUE;
                 break;
             case SIGHUP:
-                /* Walk thru */
-            case SIGUSR1:
                 main_display_info->reload = TRUE;
                 break;
+            case SIGUSR1:
+                main_display_info->dump_stats = TRUE;
+                break;
             default:
                 break;
         }
@@ -205,6 +210,7 @@ cleanUp (void)
     }
     sn_close_display ();
     sessionFreeWindowStates ();
+    sandboxClearDomains ();
 
     myDisplayClose (main_display_info);
     g_free (main_display_info);
@@ -583,7 +589,15 @@ initialize (gint compositor_mode, gboolean replace_wm)
         return -1;
     }
     main_display_info->xfilter = eventFilterInit ((gpointer) main_display_info);
-    eventFilterPush (main_display_info->xfilter, xfwm4_event_filter, (gpointer) main_display_info);
+    initEventFilters (main_display_info);
+    if (event_stats_file)
+    {
+        initEventStats (main_display_info, event_stats_file);
+    }
+    if (property_stats_file)
+    {
+        initPropertyStats (main_display_info, property_stats_file);
+    }
     initPerDisplayCallbacks (main_display_info);
 
     return sessionStart (main_display_info);
@@ -630,6 +644,8 @@ main (int argc, char **argv)
         { "compositor", '\0', 0, G_OPTION_ARG_STRING, &compositor_foo, N_("Set the compositor mode (not supported)"), "on|off|auto" },
 #endif
         { "replace", '\0', 0, G_OPTION_ARG_NONE, &replace_wm, N_("Replace the existing window manager"), NULL },
+        { "event-stats", '\0', 0, G_OPTION_ARG_FILENAME, &event_stats_file, N_("Record event processing times, written to FILE on SIGUSR1"), "FILE" },
+        { "property-stats", '\0', 0, G_OPTION_ARG_FILENAME, &property_stats_file, N_("Count and time property round trips, written to FILE on SIGUSR1"), "FILE" },
         { "version", 'V', 0, G_OPTION_ARG_NONE, &version, N_("Print version information and exit"), NULL },
         { NULL }
     };
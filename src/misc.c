@@ -249,3 +249,57 @@ get_atom_name (DisplayInfo *display_info, Atom atom)
     return value;
 }
 
+
+/*
+ * Appends a quoted JSON string, whatever characters the value holds.
+ * Atom names are Latin-1, so bytes which are not valid UTF-8 are
+ * written as the matching code points.
+ */
+void
+appendJsonString (GString *str, const gchar *value)
+{
+    const gchar *p;
+    gboolean utf8;
+
+    g_return_if_fail (str != NULL);
+
+    if (value == NULL)
+    {
+        value = "";
+    }
+    utf8 = g_utf8_validate (value, -1, NULL);
+
+    g_string_append_c (str, '"');
+    for (p = value; *p; p++)
+    {
+        switch (*p)
+        {
+            case '"':
+                g_string_append (str, "\\\"");
+                break;
+            case '\\':
+                g_string_append (str, "\\\\");
+                break;
+            case '\n':
+                g_string_append (str, "\\n");
+                break;
+            case '\r':
+                g_string_append (str, "\\r");
+                break;
+            case '\t':
+                g_string_append (str, "\\t");
+                break;
+            default:
+                if (((guchar) *p < 0x20) || (!utf8 && ((guchar) *p >= 0x80)))
+                {
+                    g_string_append_printf (str, "\\u%04x", (guint) (guchar) *p);
+                }
+                else
+                {
+                    g_string_append_c (str, *p);
+                }
+                break;
+        }
+    }
+    g_string_append_c (str, '"');
+}
@@ -70,5 +70,7 @@ void                     placeSidewalks                         (ScreenInfo *,
                                                                  gboolean);
 gchar*                   get_atom_name                          (DisplayInfo *,
                                                                  Atom);
+void                     appendJsonString                       (GString *,
+                                                                 const gchar *);
 
 #endif /* INC_MISC_H */
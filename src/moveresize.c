@@ -63,6 +63,20 @@
 #define use_xor_move(screen_info) (screen_info->params->box_move && !compositorIsActive (screen_info))
 #define use_xor_resize(screen_info) (screen_info->params->box_resize && !compositorIsActive (screen_info))
 
+/* The only events the move and resize loops consume, all others skip their filters */
+static const int moveresize_event_types[] = {
+    KeyPress,
+    ButtonRelease,
+    MotionNotify,
+    EnterNotify,
+    UnmapNotify
+};
+
+static const int button_release_event_types[] = {
+    KeyPress,
+    ButtonRelease
+};
+
 typedef struct _MoveResizeData MoveResizeData;
 struct _MoveResizeData
 {
@@ -1254,7 +1268,8 @@ clientMove (Client * c, XEvent * ev)
 
     FLAG_SET (c->xfwm_flags, XFWM_FLAG_MOVING_RESIZING);
     TRACE ("entering move loop");
-    eventFilterPush (display_info->xfilter, clientMoveEventFilter, &passdata);
+    eventFilterPushTypes (display_info->xfilter, clientMoveEventFilter, &passdata,
+                          moveresize_event_types, G_N_ELEMENTS (moveresize_event_types));
     gtk_main ();
     eventFilterPop (display_info->xfilter);
     TRACE ("leaving move loop");
@@ -1302,7 +1317,8 @@ clientMove (Client * c, XEvent * ev)
         /* If this is a drag-move, wait for the button to be released.
          * If we don't, we might get release events in the wrong place.
          */
-        eventFilterPush (display_info->xfilter, clientButtonReleaseFilter, &passdata);
+        eventFilterPushTypes (display_info->xfilter, clientButtonReleaseFilter, &passdata,
+                              button_release_event_types, G_N_ELEMENTS (button_release_event_types));
         gtk_main ();
         eventFilterPop (display_info->xfilter);
     }
@@ -1796,7 +1812,8 @@ clientResize (Client * c, int handle, XEvent * ev)
 
     FLAG_SET (c->xfwm_flags, XFWM_FLAG_MOVING_RESIZING);
     TRACE ("entering resize loop");
-    eventFilterPush (display_info->xfilter, clientResizeEventFilter, &passdata);
+    eventFilterPushTypes (display_info->xfilter, clientResizeEventFilter, &passdata,
+                          moveresize_event_types, G_N_ELEMENTS (moveresize_event_types));
     gtk_main ();
     eventFilterPop (display_info->xfilter);
     TRACE ("leaving resize loop");
@@ -1836,7 +1853,8 @@ clientResize (Client * c, int handle, XEvent * ev)
         /* If this is a drag-resize, wait for the button to be released.
          * If we don't, we might get release events in the wrong place.
          */
-        eventFilterPush (display_info->xfilter, clientButtonReleaseFilter, &passdata);
+        eventFilterPushTypes (display_info->xfilter, clientButtonReleaseFilter, &passdata,
+                              button_release_event_types, G_N_ELEMENTS (button_release_event_types));
         gtk_main ();
         eventFilterPop (display_info->xfilter);
     }
@@ -791,6 +791,39 @@ xfwmPixmapCompose (GdkPixbuf *pixbuf, const gchar * dir, const gchar * file)
     return pixbuf;
 }
 
+static gboolean
+xfwmPixmapIsOpaqueGdkPixbuf (GdkPixbuf *pixbuf)
+{
+    const guchar *pixels;
+    gint width, height, rowstride, n_channels;
+    gint x, y;
+
+    if (!gdk_pixbuf_get_has_alpha (pixbuf))
+    {
+        return TRUE;
+    }
+
+    pixels = gdk_pixbuf_get_pixels (pixbuf);
+    width = gdk_pixbuf_get_width (pixbuf);
+    height = gdk_pixbuf_get_height (pixbuf);
+    rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+    n_channels = gdk_pixbuf_get_n_channels (pixbuf);
+
+    /* Same threshold as the mask, see xfwmPixmapDrawFromGdkPixbuf() */
+    for (y = 0; y < height; y++)
+    {
+        for (x = 0; x < width; x++)
+        {
+            if (pixels[y * rowstride + x * n_channels + 3] != 0xFF)
+            {
+                return FALSE;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
 static gboolean
 xfwmPixmapDrawFromGdkPixbuf (xfwmPixmap * pm, GdkPixbuf *pixbuf)
 {
@@ -972,6 +1005,7 @@ xfwmPixmapLoad (ScreenInfo * screen_info, xfwmPixmap * pm, const gchar * dir, co
                       gdk_pixbuf_get_width (pixbuf),
                       gdk_pixbuf_get_height (pixbuf));
     xfwmPixmapDrawFromGdkPixbuf (pm, pixbuf);
+    pm->opaque = xfwmPixmapIsOpaqueGdkPixbuf (pixbuf);
 
 #ifdef HAVE_RENDER
     xfwmPixmapRefreshPict (pm);
@@ -1031,6 +1065,7 @@ xfwmPixmapCreate (ScreenInfo * screen_info, xfwmPixmap * pm,
                                   pm->pixmap, width, height, 1);
         pm->width = width;
         pm->height = height;
+        pm->opaque = FALSE;
 #ifdef HAVE_RENDER
         pm->pict_format = XRenderFindVisualFormat (myScreenGetXDisplay (screen_info),
                                                    screen_info->visual);
@@ -1047,6 +1082,7 @@ xfwmPixmapInit (ScreenInfo * screen_info, xfwmPixmap * pm)
     pm->mask = None;
     pm->width = 0;
     pm->height = 0;
+    pm->opaque = FALSE;
 #ifdef HAVE_RENDER
     pm->pict_format = XRenderFindVisualFormat (myScreenGetXDisplay (screen_info),
                                                screen_info->visual);
@@ -1062,6 +1098,7 @@ xfwmPixmapFree (xfwmPixmap * pm)
 
     pm->width = 0;
     pm->height = 0;
+    pm->opaque = FALSE;
     if (pm->pixmap != None)
     {
         XFreePixmap (myScreenGetXDisplay(pm->screen_info), pm->pixmap);
@@ -1152,4 +1189,5 @@ xfwmPixmapDuplicate (xfwmPixmap * src, xfwmPixmap * dst)
 
     xfwmPixmapCreate (src->screen_info, dst, src->width, src->height);
     xfwmPixmapFill (src, dst, 0, 0, src->width, src->height);
+    dst->opaque = src->opaque;
 }
@@ -53,6 +53,8 @@ struct _xfwmPixmap
     Picture pict;
 #endif
     gint width, height;
+    /* Mask known to be fully set, only for pixmaps loaded from the theme */
+    gboolean opaque;
 };
 
 gboolean                 xfwmPixmapRenderGdkPixbuf              (xfwmPixmap *,
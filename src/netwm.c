@@ -1551,6 +1551,10 @@ clientAddUserTimeWin (Client * c)
     screen_info = c->screen_info;
     display_info = screen_info->display_info;
 
+    if (FLAG_TEST (c->xfwm_flags, XFWM_FLAG_MANAGED))
+    {
+        myDisplayAddClientWindow (display_info, c, c->user_time_win, SEARCH_WIN_USER_TIME);
+    }
     if ((c->user_time_win != None) && (c->user_time_win != c->window))
     {
         XSelectInput (display_info->dpy, c->user_time_win, PropertyChangeMask);
@@ -1569,6 +1573,7 @@ clientRemoveUserTimeWin (Client * c)
     screen_info = c->screen_info;
     display_info = screen_info->display_info;
 
+    myDisplayRemoveClientWindow (display_info, c, c->user_time_win, SEARCH_WIN_USER_TIME);
     if ((c->user_time_win != None) && (c->user_time_win != c->window))
     {
         XSelectInput (display_info->dpy, c->user_time_win, NoEventMask);
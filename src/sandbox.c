@@ -0,0 +1,376 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+        xfwm4    - (c) 2002-2015 Olivier Fourdan
+
+        Sandbox domains are resolved from their name with a scan of /proc
+        and the environment file the exec helper leaves in its run
+        directory. Both are cached until inotify reports a change in
+        that directory.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <sys/types.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <libxfce4util/libxfce4util.h>
+
+#include <firejail/common.h>
+#include <firejail/exechelper.h>
+
+#include "client.h"
+#include "sandbox.h"
+
+/* Room for a few events at once, names included */
+#define INOTIFY_BUFFER_SIZE (16 * (sizeof (struct inotify_event) + NAME_MAX + 1))
+
+typedef struct _SandboxDomain SandboxDomain;
+struct _SandboxDomain
+{
+    pid_t pid;
+    /* Watch on the domain own run directory, -1 if none */
+    int wd;
+
+    sandboxType sandboxed;
+    gchar *sandbox_name;
+    gchar *sandbox_workspace;
+    gchar *container_name;
+};
+
+/* Sandbox domains by name, only kept while the run directory is watched */
+static GHashTable *domains = NULL;
+static int inotify_fd = -1;
+static int run_dir_wd = -1;
+static guint inotify_watch_id = 0;
+
+static void
+sandbox_domain_free (SandboxDomain *domain)
+{
+    if ((domain->wd >= 0) && (inotify_fd >= 0))
+    {
+        /* Fails harmlessly when the directory is gone or shared by another name */
+        inotify_rm_watch (inotify_fd, domain->wd);
+    }
+    g_free (domain->sandbox_name);
+    g_free (domain->sandbox_workspace);
+    g_free (domain->container_name);
+    g_free (domain);
+}
+
+static SandboxDomain *
+sandbox_domain_load (const pid_t domain_pid)
+{
+    SandboxDomain *domain;
+    char    *env_path;
+    FILE    *fp;
+    char    *buffer = NULL;
+    char    *value;
+    size_t   n = 0;
+    ssize_t  linelen = 0;
+
+    env_path = g_strdup_printf("%s/%d/%s", EXECHELP_RUN_DIR, domain_pid, DOMAIN_ENV_FILE);
+    fp = fopen(env_path, "rb");
+    g_free(env_path);
+
+    if (!fp)
+    {
+        g_warning ("Cannot open sandbox domain %d environment file: %s", domain_pid, strerror (errno));
+        return NULL;
+    }
+
+    domain = g_new0 (SandboxDomain, 1);
+    domain->pid = domain_pid;
+    domain->wd = -1;
+    domain->sandboxed = UNSANDBOXED;
+
+    while ((linelen = getline(&buffer, &n, fp)) != -1)
+    {
+        if (linelen > 0 && buffer[linelen-1] == '\n')
+            buffer[linelen-1] = '\0';
+
+        value = strchr(buffer, '=');
+        if (value)
+        {
+            *value = 0;
+            value += 1;
+
+            if (g_strcmp0 (buffer, "FIREJAIL_SANDBOX_TYPE") == 0)
+            {
+                if (g_strcmp0 (value, "untrusted") == 0)
+                    domain->sandboxed = SANDBOXED_UNTRUSTED;
+                else if (g_strcmp0 (value, "protected") == 0)
+                    domain->sandboxed = SANDBOXED_PROTECTED;
+            }
+            else if (g_strcmp0 (buffer, "FIREJAIL_SANDBOX_NAME") == 0)
+            {
+                g_free (domain->sandbox_name);
+                domain->sandbox_name = g_strdup (value);
+            }
+            else if (g_strcmp0 (buffer, "FIREJAIL_SANDBOX_WORKSPACE") == 0)
+            {
+                g_free (domain->sandbox_workspace);
+                domain->sandbox_workspace = g_strdup (value);
+            }
+            else if (g_strcmp0 (buffer, "container") == 0 || g_strcmp0 (buffer, "CONTAINER") == 0)
+            {
+                g_free (domain->container_name);
+                domain->container_name = g_strdup (value);
+            }
+        }
+        else
+        {
+            g_warning ("Invalid line in sandbox domain %d environment file: %s", domain_pid, buffer);
+        }
+    }
+
+    free(buffer);
+    fclose(fp);
+
+    return domain;
+}
+
+static void
+sandbox_cache_shutdown (void)
+{
+    if (domains)
+    {
+        g_hash_table_destroy (domains);
+        domains = NULL;
+    }
+    if (inotify_watch_id)
+    {
+        g_source_remove (inotify_watch_id);
+        inotify_watch_id = 0;
+    }
+    if (inotify_fd >= 0)
+    {
+        close (inotify_fd);
+        inotify_fd = -1;
+    }
+    run_dir_wd = -1;
+}
+
+/*
+ * Read all the pending inotify events and forget the domains if any of
+ * them changed. Returns FALSE when the run directory itself is gone and
+ * the cache must be shut down.
+ */
+static gboolean
+sandbox_cache_read_events (void)
+{
+    char buffer[INOTIFY_BUFFER_SIZE] __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+    const struct inotify_event *event;
+    gboolean changed;
+    ssize_t len;
+    char *ptr;
+
+    TRACE ("entering sandbox_cache_read_events");
+
+    changed = FALSE;
+    while ((len = read (inotify_fd, buffer, sizeof (buffer))) > 0)
+    {
+        ptr = buffer;
+        while (ptr < buffer + len)
+        {
+            event = (const struct inotify_event *) ptr;
+            if ((event->wd == run_dir_wd) && (event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)))
+            {
+                return FALSE;
+            }
+            /* Watches removed by ourselves or along with their directory */
+            if (!(event->mask & IN_IGNORED))
+            {
+                changed = TRUE;
+            }
+            ptr += sizeof (struct inotify_event) + event->len;
+        }
+    }
+
+    if (changed)
+    {
+        /* Domains come and go rarely, simply forget them all */
+        TRACE ("sandbox run directory changed, flushing %u domains", g_hash_table_size (domains));
+        g_hash_table_remove_all (domains);
+    }
+
+    return TRUE;
+}
+
+static gboolean
+sandbox_cache_notify (GIOChannel *channel, GIOCondition condition, gpointer data)
+{
+    TRACE ("entering sandbox_cache_notify");
+
+    if (!sandbox_cache_read_events ())
+    {
+        /* The run directory itself is gone, start over on the next lookup */
+        inotify_watch_id = 0;
+        sandbox_cache_shutdown ();
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean
+sandbox_cache_init (void)
+{
+    GIOChannel *channel;
+
+    if (domains)
+    {
+        return TRUE;
+    }
+
+    inotify_fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0)
+    {
+        return FALSE;
+    }
+    run_dir_wd = inotify_add_watch (inotify_fd, EXECHELP_RUN_DIR,
+                                    IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                    IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+    if (run_dir_wd < 0)
+    {
+        /* No sandbox started yet, try again next time */
+        sandbox_cache_shutdown ();
+        return FALSE;
+    }
+
+    channel = g_io_channel_unix_new (inotify_fd);
+    inotify_watch_id = g_io_add_watch (channel, G_IO_IN, sandbox_cache_notify, NULL);
+    g_io_channel_unref (channel);
+
+    domains = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                     g_free, (GDestroyNotify) sandbox_domain_free);
+
+    return TRUE;
+}
+
+static void
+sandbox_domain_apply (Client *c, SandboxDomain *domain)
+{
+    c->sandboxed = domain->sandboxed;
+    if (domain->sandbox_name)
+    {
+        g_free (c->sandbox_name);
+        c->sandbox_name = g_strdup (domain->sandbox_name);
+    }
+    if (domain->sandbox_workspace)
+    {
+        g_free (c->sandbox_workspace);
+        c->sandbox_workspace = g_strdup (domain->sandbox_workspace);
+    }
+    if (domain->container_name)
+    {
+        g_free (c->container_name);
+        c->container_name = g_strdup (domain->container_name);
+    }
+}
+
+gboolean
+sandboxLoadDomain (Client *c, const gchar *name)
+{
+    SandboxDomain *domain;
+    gchar *dir_path;
+    pid_t pid;
+    int wd;
+
+    g_return_val_if_fail (c != NULL, FALSE);
+    g_return_val_if_fail (name != NULL, FALSE);
+    TRACE ("entering sandboxLoadDomain \"%s\"", name);
+
+    if (sandbox_cache_init ())
+    {
+        /*
+         * The main loop may not have dispatched the events of a domain
+         * that was just restarted or removed, never trust the table
+         * before they are read.
+         */
+        if (!sandbox_cache_read_events ())
+        {
+            sandbox_cache_shutdown ();
+        }
+        else
+        {
+            domain = g_hash_table_lookup (domains, name);
+            if (domain)
+            {
+                sandbox_domain_apply (c, domain);
+                return TRUE;
+            }
+        }
+    }
+
+    if (name2pid ((char *) name, &pid) != 0)
+    {
+        return FALSE;
+    }
+
+    /* Watch the domain directory before reading it, so no update goes unnoticed */
+    wd = -1;
+    if (domains)
+    {
+        dir_path = g_strdup_printf ("%s/%d", EXECHELP_RUN_DIR, pid);
+        wd = inotify_add_watch (inotify_fd, dir_path,
+                                IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MOVED_FROM |
+                                IN_MOVED_TO | IN_ONLYDIR);
+        g_free (dir_path);
+    }
+
+    domain = sandbox_domain_load (pid);
+    if (domain == NULL)
+    {
+        if (wd >= 0)
+        {
+            inotify_rm_watch (inotify_fd, wd);
+        }
+        return FALSE;
+    }
+    sandbox_domain_apply (c, domain);
+
+    if (wd >= 0)
+    {
+        domain->wd = wd;
+        g_hash_table_replace (domains, g_strdup (name), domain);
+    }
+    else
+    {
+        /* Cannot tell when it changes, do not keep it */
+        sandbox_domain_free (domain);
+    }
+
+    return TRUE;
+}
+
+void
+sandboxClearDomains (void)
+{
+    TRACE ("entering sandboxClearDomains");
+
+    sandbox_cache_shutdown ();
+}
@@ -0,0 +1,35 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+        xfwm4    - (c) 2002-2015 Olivier Fourdan
+
+ */
+
+#ifndef INC_SANDBOX_H
+#define INC_SANDBOX_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "client.h"
+
+gboolean                 sandboxLoadDomain                      (Client *,
+                                                                 const gchar *);
+void                     sandboxClearDomains                    (void);
+
+#endif /* INC_SANDBOX_H */
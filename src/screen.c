@@ -49,6 +49,7 @@
 #include "mywindow.h"
 #include "compositor.h"
 #include "ui_style.h"
+#include "workspaces.h"
 
 #ifndef WM_EXITING_TIMEOUT
 #define WM_EXITING_TIMEOUT 15 /*seconds */
@@ -237,6 +238,9 @@ myScreenInit (DisplayInfo *display_info, GdkScreen *gscr, unsigned long event_ma
     screen_info->workspace_count = 0;
     screen_info->workspace_names = NULL;
     screen_info->workspace_names_items = 0;
+    screen_info->workspace_policy = NULL;
+    screen_info->workspace_policy_count = 0;
+    screen_info->workspace_policy_serial = 1;
 
     screen_info->windows_stack = NULL;
     screen_info->last_raise = NULL;
@@ -301,6 +305,7 @@ myScreenInit (DisplayInfo *display_info, GdkScreen *gscr, unsigned long event_ma
 #endif
 
     screen_info->font_height = 0;
+    screen_info->font_serial = 1;
     screen_info->box_gc = None;
     screen_info->black_gc = NULL;
     screen_info->white_gc = NULL;
@@ -398,6 +403,7 @@ myScreenClose (ScreenInfo *screen_info)
     }
     screen_info->workspace_names = NULL;
     screen_info->workspace_names_items = 0;
+    workspaceInvalidatePolicy (screen_info);
 
     if (screen_info->shape_win != None)
     {
@@ -862,6 +868,7 @@ myScreenUpdateFontHeight (ScreenInfo *screen_info)
     widget = myScreenGetGtkWidget (screen_info);
     context = getUIPangoContext (widget);
     desc = getUIPangoFontDesc (widget);
+    screen_info->font_serial++;
 
     if (desc && context)
     {
@@ -53,6 +53,7 @@
 #include "mypixmap.h"
 #include "client.h"
 #include "hints.h"
+#include "gaussian.h"
 
 #define MODIFIER_MASK           (ShiftMask | \
                                  ControlMask | \
@@ -63,13 +64,34 @@
 
 
 #ifdef HAVE_COMPOSITOR
-struct _gaussian_conv {
-    int     size;
-    double  *data;
+struct _compositor_stats {
+    guint64 frames;
+    gint64  paint_time;         /* usec, last frame */
+    gint64  max_paint_time;     /* usec */
+    gint64  total_paint_time;   /* usec */
+    guint   windows_painted;    /* last frame */
+    guint   windows_skipped;    /* last frame, windows below the covered damage are not counted */
+    guint64 damage_area;        /* pixels, bounding box of the last frame damage */
+    gulong  requests;           /* X requests issued by the last frame */
 };
-typedef struct _gaussian_conv gaussian_conv;
+typedef struct _compositor_stats compositor_stats;
 #endif /* HAVE_COMPOSITOR */
 
+typedef enum
+{
+    WORKSPACE_POLICY_SECURE                 = (1 << 0),
+    WORKSPACE_POLICY_LET_SANDBOXED_OUT      = (1 << 1),
+    WORKSPACE_POLICY_ENTER_UNSANDBOXED      = (1 << 2),
+    WORKSPACE_POLICY_ENTER_REPLACE          = (1 << 3)
+}
+workspacePolicyFlags;
+
+struct _WorkspacePolicy {
+    guint flags;
+    guint name_index;           /* first workspace with the same name, G_MAXUINT if unnamed */
+};
+typedef struct _WorkspacePolicy WorkspacePolicy;
+
 struct _ScreenInfo
 {
     /* The display this screen belongs to */
@@ -101,6 +123,8 @@ struct _ScreenInfo
 
     /* Title font height */
     gint font_height;
+    /* Bumped on font changes, invalidates the client title layouts */
+    guint font_serial;
 
     /* Screen data */
     Colormap cmap;
@@ -134,6 +158,10 @@ struct _ScreenInfo
     guint workspace_count;
     gchar **workspace_names;
     int workspace_names_items;
+    /* Security policy of each workspace, see workspaceGetPolicy() */
+    WorkspacePolicy *workspace_policy;
+    guint workspace_policy_count;
+    guint workspace_policy_serial;
     NetWmDesktopLayout desktop_layout;
 
     /* Button handler for GTK */
@@ -176,6 +204,7 @@ struct _ScreenInfo
     gint gaussianSize;
     guchar *shadowCorner;
     guchar *shadowTop;
+    Picture *shadowSlices;
 
     gushort current_buffer;
     Pixmap rootPixmap[2];
@@ -184,8 +213,8 @@ struct _ScreenInfo
     Picture rootPicture;
     Picture blackPicture;
     Picture rootTile;
-    XserverRegion prevDamage;
-    XserverRegion allDamage;
+    Region prevDamage;
+    Region allDamage;
     unsigned long cursorSerial;
     Picture cursorPicture;
     gint cursorOffsetX;
@@ -197,8 +226,18 @@ struct _ScreenInfo
     gboolean clipChanged;
 
     gboolean damages_pending;
+    compositor_stats stats;
 
     guint compositor_timeout_id;
+    Window unredirected_fullscreen;
+    guint unredirect_timeout_id;
+    guint thumbnail_timeout_id;
+    gint64 frame_interval;
+    gint64 last_vblank_time;
+    gint64 next_frame_time;
+    gint64 painted_frame_time;
+    guint64 last_ust;
+    guint64 last_msc;
 
     XTransform transform;
     gboolean zoomed;
@@ -227,6 +266,8 @@ struct _ScreenInfo
 
 #ifdef HAVE_PRESENT_EXTENSION
     gboolean present_pending;
+    /* Update region of each flip, reused from one frame to the next */
+    XserverRegion present_region;
 #endif /* HAVE_PRESENT_EXTENSION */
 
 #endif /* HAVE_COMPOSITOR */
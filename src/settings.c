@@ -834,6 +834,7 @@ loadSettings (ScreenInfo *screen_info)
         {"cycle_hidden", NULL, G_TYPE_BOOLEAN, TRUE},
         {"cycle_minimum", NULL, G_TYPE_BOOLEAN, TRUE},
         {"cycle_preview", NULL, G_TYPE_BOOLEAN, TRUE},
+        {"cycle_preview_refresh", NULL, G_TYPE_BOOLEAN, FALSE},
         {"cycle_tabwin_mode", NULL, G_TYPE_INT, FALSE},
         {"cycle_workspaces", NULL, G_TYPE_BOOLEAN, TRUE},
         {"double_click_action", NULL, G_TYPE_STRING, TRUE},
@@ -890,6 +891,7 @@ loadSettings (ScreenInfo *screen_info)
         {"title_vertical_offset_active", NULL, G_TYPE_INT, TRUE},
         {"title_vertical_offset_inactive", NULL, G_TYPE_INT, TRUE},
         {"toggle_workspaces", NULL, G_TYPE_BOOLEAN, TRUE},
+        {"unredirect_fullscreen", NULL, G_TYPE_BOOLEAN, TRUE},
         {"unredirect_overlays", NULL, G_TYPE_BOOLEAN, TRUE},
         {"urgent_blink", NULL, G_TYPE_BOOLEAN, TRUE},
         {"use_compositing", NULL, G_TYPE_BOOLEAN, TRUE},
@@ -947,6 +949,8 @@ loadSettings (ScreenInfo *screen_info)
         getBoolValue ("cycle_hidden", rc);
     screen_info->params->cycle_preview =
         getBoolValue ("cycle_preview", rc);
+    screen_info->params->cycle_preview_refresh =
+        getBoolValue ("cycle_preview_refresh", rc);
     screen_info->params->cycle_tabwin_mode =
         CLAMP (getIntValue ("cycle_tabwin_mode", rc), 0, 1);
     screen_info->params->cycle_workspaces =
@@ -1011,6 +1015,8 @@ loadSettings (ScreenInfo *screen_info)
         getBoolValue ("tile_on_move", rc);
     screen_info->params->toggle_workspaces =
         getBoolValue ("toggle_workspaces", rc);
+    screen_info->params->unredirect_fullscreen =
+        getBoolValue ("unredirect_fullscreen", rc);
     screen_info->params->unredirect_overlays =
         getBoolValue ("unredirect_overlays", rc);
     screen_info->params->use_compositing =
@@ -1164,6 +1170,8 @@ reloadScreenSettings (ScreenInfo *screen_info, int mask)
     {
         return FALSE;
     }
+    /* The workspace security settings may have changed as well */
+    workspaceInvalidatePolicy (screen_info);
     if (mask)
     {
         clientUpdateAllFrames (screen_info, mask);
@@ -1253,6 +1261,7 @@ initSettings (ScreenInfo *screen_info)
     {
         screen_info->workspace_names = NULL;
         screen_info->workspace_names_items = 0;
+        workspaceInvalidatePolicy (screen_info);
     }
 
     getDesktopLayout(display_info, screen_info->xroot, screen_info->workspace_count, &screen_info->desktop_layout);
@@ -1507,6 +1516,10 @@ cb_xfwm4_channel_property_changed(XfconfChannel *channel, const gchar *property_
                 {
                     screen_info->params->cycle_preview = g_value_get_boolean (value);
                 }
+                else if (!strcmp (name, "cycle_preview_refresh"))
+                {
+                    screen_info->params->cycle_preview_refresh = g_value_get_boolean (value);
+                }
                 else if (!strcmp (name, "focus_hint"))
                 {
                     screen_info->params->focus_hint = g_value_get_boolean (value);
@@ -1563,6 +1576,11 @@ cb_xfwm4_channel_property_changed(XfconfChannel *channel, const gchar *property_
                 {
                     screen_info->params->toggle_workspaces = g_value_get_boolean (value);
                 }
+                else if (!strcmp (name, "unredirect_fullscreen"))
+                {
+                    screen_info->params->unredirect_fullscreen = g_value_get_boolean (value);
+                    compositorCheckUnredirect (screen_info);
+                }
                 else if (!strcmp (name, "unredirect_overlays"))
                 {
                     screen_info->params->unredirect_overlays = g_value_get_boolean (value);
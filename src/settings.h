@@ -220,6 +220,7 @@ struct _XfwmParams
     gboolean cycle_hidden;
     gboolean cycle_minimum;
     gboolean cycle_preview;
+    gboolean cycle_preview_refresh;
     gboolean cycle_workspaces;
     gboolean focus_hint;
     gboolean focus_new;
@@ -244,6 +245,7 @@ struct _XfwmParams
     gboolean title_vertical_offset_active;
     gboolean title_vertical_offset_inactive;
     gboolean toggle_workspaces;
+    gboolean unredirect_fullscreen;
     gboolean unredirect_overlays;
     gboolean urgent_blink;
     gboolean use_compositing;
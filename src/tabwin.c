@@ -63,6 +63,7 @@
 #include <math.h>
 #include <glib.h>
 #include <gdk/gdk.h>
+#include <gdk/gdkx.h>
 #include <gtk/gtk.h>
 #include <libxfce4util/libxfce4util.h>
 #include "icons.h"
@@ -376,6 +377,79 @@ createWindowIcon (GdkPixbuf *icon_pixbuf)
     return icon;
 }
 
+/*
+ * The window content is composited by the compositor straight into what
+ * GTK is painting to, so it never has to be read back from the server.
+ * Only the small application icon on top is a pixbuf. When the compositor
+ * has nothing to paint, the application icon is drawn at full size instead.
+ */
+static gboolean
+paintWindowPreview (GtkWidget *preview, GdkEventExpose *event, gpointer data)
+{
+    Client *c;
+    GdkPixbuf *icon_pixbuf;
+    GdkDrawable *drawable;
+    gint x_offset, y_offset;
+    gint x, y, size, icon_size;
+    gboolean painted;
+
+    c = (Client *) data;
+    icon_pixbuf = (GdkPixbuf *) g_object_get_data (G_OBJECT (preview), "icon-pixbuf");
+
+    size = MIN (preview->allocation.width, preview->allocation.height);
+    x = preview->allocation.x + (preview->allocation.width - size) / 2;
+    y = preview->allocation.y + preview->allocation.height - size;
+
+    gdk_window_get_internal_paint_info (preview->window, &drawable, &x_offset, &y_offset);
+    painted = compositorPaintWindowThumbnail (c->screen_info, c->frame,
+                                              GDK_DRAWABLE_XID (drawable),
+                                              GDK_VISUAL_XVISUAL (gdk_drawable_get_visual (preview->window)),
+                                              x - x_offset, y - y_offset, size, size,
+                                              FLAG_TEST (c->flags, CLIENT_FLAG_ICONIFIED));
+
+    if (!painted)
+    {
+        /* Loaded on first use only, most previews never need it */
+        icon_pixbuf = (GdkPixbuf *) g_object_get_data (G_OBJECT (preview), "full-icon-pixbuf");
+        if (icon_pixbuf == NULL)
+        {
+            icon_pixbuf = getAppIcon (c->screen_info, c->window, size, size);
+            g_object_set_data_full (G_OBJECT (preview), "full-icon-pixbuf",
+                                    icon_pixbuf, g_object_unref);
+        }
+        gdk_draw_pixbuf (preview->window, NULL, icon_pixbuf, 0, 0,
+                         x + (size - gdk_pixbuf_get_width (icon_pixbuf)) / 2,
+                         y + (size - gdk_pixbuf_get_height (icon_pixbuf)) / 2,
+                         -1, -1, GDK_RGB_DITHER_NONE, 0, 0);
+    }
+    else if (icon_pixbuf)
+    {
+        icon_size = gdk_pixbuf_get_width (icon_pixbuf);
+        gdk_draw_pixbuf (preview->window, NULL, icon_pixbuf, 0, 0,
+                         x + (size - icon_size) / 2, y + size - icon_size,
+                         -1, -1, GDK_RGB_DITHER_NONE, 0, 0);
+    }
+
+    return FALSE;
+}
+
+static GtkWidget *
+createWindowPreview (Client *c, GdkPixbuf *icon_pixbuf, gint size)
+{
+    GtkWidget *preview;
+
+    TRACE ("entering createWindowPreview");
+
+    /* An empty image is just a windowless placeholder of the right size */
+    preview = gtk_image_new ();
+    gtk_widget_set_size_request (preview, size, size);
+    g_object_set_data (G_OBJECT (preview), "icon-pixbuf", icon_pixbuf);
+    g_signal_connect (preview, "expose-event",
+                      G_CALLBACK (paintWindowPreview), c);
+
+    return preview;
+}
+
 static int
 getMinMonitorWidth (ScreenInfo *screen_info)
 {
@@ -537,7 +611,14 @@ createWindowlist (ScreenInfo *screen_info, TabwinWidget *tabwin_widget)
                           G_CALLBACK (cb_window_button_leave), tabwin_widget);
         gtk_widget_add_events (window_button, GDK_ENTER_NOTIFY_MASK);
 
-        icon = createWindowIcon (icon_pixbuf);
+        if (tabwin->preview)
+        {
+            icon = createWindowPreview (c, icon_pixbuf, tabwin->icon_size);
+        }
+        else
+        {
+            icon = createWindowIcon (icon_pixbuf);
+        }
         if (screen_info->params->cycle_tabwin_mode == STANDARD_ICON_GRID)
         {
             gtk_widget_set_size_request (GTK_WIDGET (window_button), size_request, size_request);
@@ -700,6 +781,7 @@ computeTabwinData (ScreenInfo *screen_info, TabwinWidget *tabwin_widget)
     GList *client_list;
     gint size_request;
     gint standard_icon_size;
+    gint small_icon_size;
     gboolean preview;
 
     TRACE ("entering computeTabwinData");
@@ -778,7 +860,10 @@ computeTabwinData (ScreenInfo *screen_info, TabwinWidget *tabwin_widget)
                                           (double) (tabwin->icon_size + 2 * WIN_ICON_BORDER)));
         tabwin->grid_cols = (int) (ceil ((double) tabwin->client_count /
                                          (double) tabwin->grid_rows));
+        /* No preview in list mode */
+        preview = FALSE;
     }
+    tabwin->preview = preview;
 
     /* pack the client icons */
     for (client_list = *tabwin->client_list; client_list; client_list = g_list_next (client_list))
@@ -789,7 +874,10 @@ computeTabwinData (ScreenInfo *screen_info, TabwinWidget *tabwin_widget)
         {
             if (preview)
             {
-                icon_pixbuf = getClientIcon (c, tabwin->icon_size, tabwin->icon_size);
+                /* Only the small icon, the preview is painted by the compositor */
+                small_icon_size = MIN (tabwin->icon_size / 4, 48);
+                icon_pixbuf = getAppIcon (c->screen_info, c->window,
+                                          small_icon_size, small_icon_size);
             }
             else
             {
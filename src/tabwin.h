@@ -56,6 +56,7 @@ struct _Tabwin
     gint icon_size;
     gint label_height;
     gboolean display_workspace;
+    gboolean preview;
 };
 
 struct _TabwinWidget
@@ -259,8 +259,8 @@ workspaceMove (ScreenInfo *screen_info, gint rowmod, gint colmod, Client * c, gu
     return (screen_info->current_ws != previous_ws);
 }
 
-void
-workspaceSwitch (ScreenInfo *screen_info, gint new_ws, Client * c2, gboolean update_focus, guint32 timestamp)
+static void
+workspace_switch (ScreenInfo *screen_info, gint new_ws, Client * c2, gboolean update_focus, guint32 timestamp)
 {
     DisplayInfo *display_info;
     Client *c, *new_focus;
@@ -445,6 +445,17 @@ workspaceSwitch (ScreenInfo *screen_info, gint new_ws, Client * c2, gboolean upd
     }
 }
 
+void
+workspaceSwitch (ScreenInfo *screen_info, gint new_ws, Client * c2, gboolean update_focus, guint32 timestamp)
+{
+    const gchar *operation;
+
+    operation = setPropertyStatsOperation ("workspace switch");
+    workspaceRefreshPolicy (screen_info);
+    workspace_switch (screen_info, new_ws, c2, update_focus, timestamp);
+    setPropertyStatsOperation (operation);
+}
+
 void
 workspaceSetNames (ScreenInfo * screen_info, gchar **names, int items)
 {
@@ -460,6 +471,7 @@ workspaceSetNames (ScreenInfo * screen_info, gchar **names, int items)
 
     screen_info->workspace_names = names;
     screen_info->workspace_names_items = items;
+    workspaceInvalidatePolicy (screen_info);
 }
 
 void
@@ -485,6 +497,7 @@ workspaceSetCount (ScreenInfo * screen_info, guint count)
     display_info = screen_info->display_info;
     setHint (display_info, screen_info->xroot, NET_NUMBER_OF_DESKTOPS, count);
     screen_info->workspace_count = count;
+    workspaceInvalidatePolicy (screen_info);
 
     for (list = screen_info->windows_stack; list; list = g_list_next (list))
     {
@@ -646,3 +659,102 @@ workspaceUpdateArea (ScreenInfo *screen_info)
         clientScreenResize(screen_info, FALSE);
     }
 }
+
+void
+workspaceInvalidatePolicy (ScreenInfo *screen_info)
+{
+    g_return_if_fail (screen_info != NULL);
+
+    TRACE ("entering workspaceInvalidatePolicy");
+
+    workspaceRefreshPolicy (screen_info);
+    /* Client workspaces resolved against the previous names are stale too */
+    screen_info->workspace_policy_serial++;
+}
+
+/*
+ * The security settings come with no change notification, so they are read
+ * again at the start of each workspace switch or move. The names did not
+ * change, the workspaces resolved by clients remain valid.
+ */
+void
+workspaceRefreshPolicy (ScreenInfo *screen_info)
+{
+    g_return_if_fail (screen_info != NULL);
+
+    TRACE ("entering workspaceRefreshPolicy");
+
+    g_free (screen_info->workspace_policy);
+    screen_info->workspace_policy = NULL;
+    screen_info->workspace_policy_count = 0;
+}
+
+static void
+workspace_build_policy (ScreenInfo *screen_info)
+{
+    WorkspacePolicy *policy;
+    gchar **names;
+    guint count, items, i, j;
+
+    TRACE ("entering workspace_build_policy");
+
+    count = screen_info->workspace_count;
+    names = screen_info->workspace_names;
+    items = (names) ? (guint) MAX (screen_info->workspace_names_items, 0) : 0;
+    policy = g_new0 (WorkspacePolicy, count);
+
+    for (i = 0; i < count; i++)
+    {
+        if (xfce_workspace_is_secure (i))
+        {
+            policy[i].flags |= WORKSPACE_POLICY_SECURE;
+        }
+        if (xfce_workspace_let_sandboxed_out (i))
+        {
+            policy[i].flags |= WORKSPACE_POLICY_LET_SANDBOXED_OUT;
+        }
+        if (xfce_workspace_unsandboxed_in_behavior (i) == XFCE_WORKSPACE_ENTER_REPLACE)
+        {
+            policy[i].flags |= WORKSPACE_POLICY_ENTER_REPLACE;
+        }
+        else if (xfce_workspace_let_unsandboxed_in (i) &&
+                 (xfce_workspace_unsandboxed_in_behavior (i) == XFCE_WORKSPACE_ENTER_UNSANDBOXED))
+        {
+            policy[i].flags |= WORKSPACE_POLICY_ENTER_UNSANDBOXED;
+        }
+
+        /* Names are compared once here, afterwards by index */
+        policy[i].name_index = G_MAXUINT;
+        for (j = 0; (i < items) && (j <= i); j++)
+        {
+            if (g_strcmp0 (names[j], names[i]) == 0)
+            {
+                policy[i].name_index = j;
+                break;
+            }
+        }
+    }
+
+    screen_info->workspace_policy = policy;
+    screen_info->workspace_policy_count = count;
+}
+
+const WorkspacePolicy *
+workspaceGetPolicy (ScreenInfo *screen_info, guint ws)
+{
+    static const WorkspacePolicy none = { 0, G_MAXUINT };
+
+    g_return_val_if_fail (screen_info != NULL, &none);
+
+    if (ws >= screen_info->workspace_count)
+    {
+        return &none;
+    }
+    if (screen_info->workspace_policy_count != screen_info->workspace_count)
+    {
+        g_free (screen_info->workspace_policy);
+        workspace_build_policy (screen_info);
+    }
+
+    return &screen_info->workspace_policy[ws];
+}
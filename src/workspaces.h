@@ -57,6 +57,10 @@ void                    workspaceSetNames                       (ScreenInfo *,
 void                    workspaceSetCount                       (ScreenInfo *,
                                                                  guint);
 void                    workspaceUpdateArea                     (ScreenInfo *);
+void                    workspaceInvalidatePolicy               (ScreenInfo *);
+void                    workspaceRefreshPolicy                  (ScreenInfo *);
+const WorkspacePolicy  *workspaceGetPolicy                      (ScreenInfo *,
+                                                                 guint);
 
 void                    workspaceInsert                         (ScreenInfo *,
                                                                  guint);
@@ -95,7 +95,13 @@ clientCreateXSyncAlarm (Client *c)
                                        XSyncCAValue |
                                        XSyncCAValueType,
                                        &attrs);
-    return (c->xsync_alarm != None);
+    if (c->xsync_alarm == None)
+    {
+        return FALSE;
+    }
+    myDisplayAddXSyncAlarm (display_info, c->xsync_alarm, c);
+
+    return TRUE;
 }
 
 void
@@ -113,6 +119,7 @@ clientDestroyXSyncAlarm (Client *c)
         screen_info = c->screen_info;
         display_info = screen_info->display_info;
 
+        myDisplayRemoveXSyncAlarm (display_info, c->xsync_alarm);
         XSyncDestroyAlarm (display_info->dpy, c->xsync_alarm);
         c->xsync_alarm = None;
     }